@@ -0,0 +1,51 @@
+#pragma once
+#include <JuceHeader.h>
+#include <iostream>
+#include <limits>
+
+/*
+ * Small helpers shared by all benchmarks. Every benchmark runs its workload a few times to warm up the caches
+ * and then reports the best (lowest) time of the measured repetitions, which is the least noisy figure on a
+ * desktop machine where other processes may interrupt us.
+ */
+namespace Benchmark
+{
+	constexpr auto WARM_UP_REPETITIONS = 3;
+	constexpr auto MEASURED_REPETITIONS = 10;
+
+	// returns the best time in nanoseconds that a single call of workload took
+	template <typename Workload>
+	double measureNanoseconds(Workload&& workload)
+	{
+		for (auto i = 0; i < WARM_UP_REPETITIONS; ++i)
+		{
+			workload();
+		}
+
+		auto bestTicks = std::numeric_limits<juce::int64>::max();
+
+		for (auto i = 0; i < MEASURED_REPETITIONS; ++i)
+		{
+			const auto start = juce::Time::getHighResolutionTicks();
+			workload();
+			bestTicks = std::min(bestTicks, juce::Time::getHighResolutionTicks() - start);
+		}
+
+		return 1.0e9 * static_cast<double>(bestTicks) / static_cast<double>(juce::Time::getHighResolutionTicksPerSecond());
+	}
+
+	/* The compiler may remove a computation whose result is never used. Passing the rendered buffers through
+	 * this function keeps them alive without adding measurable cost.
+	 */
+	inline void doNotOptimizeAway(const float* data, int numSamples)
+	{
+		static volatile float sink = 0.f;
+		sink = sink + data[0] + data[numSamples - 1];
+	}
+}
+
+void runWavetableOscillatorBenchmarks();
+void runPhaseModeBenchmarks();
+void runInterpolationBenchmarks();
+void runWavetableSynthBenchmarks();
+void runSimpleEQBenchmarks();
@@ -0,0 +1,139 @@
+#include "Benchmark.h"
+#include "../../WavetableSynth/Source/WavetableVoiceBank.h"
+
+namespace
+{
+	constexpr auto SAMPLE_RATE = 48000.0;
+	// a short table is where the interpolation matters most, every sample of the period is far apart
+	constexpr auto TABLE_SIZE = 64;
+	// the attack of the default envelope is over by then, from there on every voice plays at full level
+	constexpr auto SETTLE_SAMPLES = 4800;
+	/* The notes are k / 2^18 of the sample rate. For k below 2^24 / 375 such a frequency is a float, and so is the
+	 * fraction of the sample rate, so the phase increment of the voice bank is exactly k * 2^14 and its phase at
+	 * any sample follows from the sample number without rounding. An odd k makes the samples land on a different
+	 * point of the period every time.
+	 */
+	constexpr auto PHASE_BITS = 18;
+
+	std::vector<float> generateSineWaveTable(int length)
+	{
+		std::vector<float> sineWaveTable(static_cast<size_t>(length));
+
+		for (auto i = 0; i < length; ++i)
+		{
+			sineWaveTable[static_cast<size_t>(i)] = std::sin(juce::MathConstants<float>::twoPi * static_cast<float>(i) / static_cast<float>(length));
+		}
+
+		return sineWaveTable;
+	}
+
+	const char* getName(Interpolation::Type type)
+	{
+		switch (type)
+		{
+		case Interpolation::Type::none: return "none";
+		case Interpolation::Type::linear: return "linear";
+		case Interpolation::Type::cubicHermite: return "cubicHermite";
+		case Interpolation::Type::lagrange: return "lagrange";
+		}
+
+		return "";
+	}
+
+	// the odd multiple of SAMPLE_RATE / 2^PHASE_BITS next to frequency
+	juce::int64 getExactPhaseStep(float frequency)
+	{
+		const auto step = static_cast<juce::int64>(std::llround(frequency / SAMPLE_RATE * (1 << PHASE_BITS)));
+		return step | 1;
+	}
+
+	/* Renders one second of a sine from the table with a single voice of the voice bank, and compares it with the
+	 * exact sine at the same phase. The difference is everything the interpolation adds (noise and aliasing) or
+	 * removes (droop), so the signal-to-error ratio in dB is the quality figure of the policy.
+	 */
+	double measureSignalToErrorRatio(const Wavetable::Ptr& waveTable, Interpolation::Type type, float frequency)
+	{
+		constexpr auto BLOCK_SIZE = 512;
+
+		const auto phaseStep = getExactPhaseStep(frequency);
+		WavetableVoiceBank voiceBank;
+		voiceBank.exchangeWaveTable(waveTable);
+		voiceBank.setSampleRate(SAMPLE_RATE);
+		voiceBank.setInterpolation(type);
+		voiceBank.startVoice(69, static_cast<float>(SAMPLE_RATE * static_cast<double>(phaseStep) / (1 << PHASE_BITS)));
+
+		// a centred voice has a gain of 1 in the mono mix
+		std::vector<float> output(BLOCK_SIZE);
+		auto signalEnergy = 0.0;
+		auto errorEnergy = 0.0;
+
+		for (auto blockStart = 0; blockStart < static_cast<int>(SAMPLE_RATE); blockStart += BLOCK_SIZE)
+		{
+			std::fill(output.begin(), output.end(), 0.f);
+			voiceBank.render(output.data(), nullptr, BLOCK_SIZE);
+
+			for (auto i = std::max(0, SETTLE_SAMPLES - blockStart); i < BLOCK_SIZE; ++i)
+			{
+				// the first voice starts at phase 0 and its phase is exact, see PHASE_BITS
+				const auto periods = static_cast<double>((static_cast<juce::int64>(blockStart + i) * phaseStep)
+					& ((1 << PHASE_BITS) - 1)) / (1 << PHASE_BITS);
+				const auto expected = std::sin(juce::MathConstants<double>::twoPi * periods);
+				const auto error = static_cast<double>(output[static_cast<size_t>(i)]) - expected;
+				signalEnergy += expected * expected;
+				errorEnergy += error * error;
+			}
+		}
+
+		return 10.0 * std::log10(signalEnergy / errorEnergy);
+	}
+}
+
+/* Quality vs cost of the interpolation policies in the lane loop of WavetableVoiceBank, which is what the plugin
+ * renders with: the time per voice and sample of a chord of voices summed into one buffer, and the
+ * signal-to-error ratio of a sine from a 64-sample table. A policy is worth its cost on a patch if its gain in dB
+ * is audible there.
+ */
+void runInterpolationBenchmarks()
+{
+	constexpr auto VOICES = 64;
+	constexpr auto BLOCK_SIZE = 256;
+	constexpr auto BLOCKS_PER_REPETITION = 100;
+
+	const Wavetable::Ptr waveTable{ new Wavetable{ generateSineWaveTable(TABLE_SIZE) } };
+
+	std::cout << "WavetableVoiceBank: interpolation quality vs cost" << std::endl;
+	std::cout << "interpolation,frequency,nsPerSample,signalToErrorDb" << std::endl;
+
+	for (const auto type : { Interpolation::Type::none, Interpolation::Type::linear,
+		Interpolation::Type::cubicHermite, Interpolation::Type::lagrange })
+	{
+		for (const auto frequency : { 110.f, 880.f, 7040.f })
+		{
+			WavetableVoiceBank voiceBank;
+			voiceBank.exchangeWaveTable(waveTable);
+			voiceBank.setSampleRate(SAMPLE_RATE);
+			voiceBank.setPolyphony(VOICES);
+			voiceBank.setInterpolation(type);
+			for (auto voice = 0; voice < VOICES; ++voice)
+			{
+				voiceBank.startVoice(voice, frequency * (1.f + 0.01f * static_cast<float>(voice)));
+			}
+
+			std::vector<float> output(static_cast<size_t>(BLOCK_SIZE));
+			const auto samplesPerRepetition = static_cast<double>(VOICES * BLOCKS_PER_REPETITION * BLOCK_SIZE);
+
+			const auto nanoseconds = Benchmark::measureNanoseconds([&]
+			{
+				for (auto block = 0; block < BLOCKS_PER_REPETITION; ++block)
+				{
+					std::fill(output.begin(), output.end(), 0.f);
+					voiceBank.render(output.data(), nullptr, BLOCK_SIZE);
+					Benchmark::doNotOptimizeAway(output.data(), BLOCK_SIZE);
+				}
+			}) / samplesPerRepetition;
+
+			std::cout << getName(type) << "," << frequency << "," << nanoseconds << ","
+				<< measureSignalToErrorRatio(waveTable, type, frequency) << std::endl;
+		}
+	}
+}
@@ -0,0 +1,29 @@
+/*
+  ==============================================================================
+
+    This file contains the basic startup code for a JUCE application.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "Benchmark.h"
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    juce::ignoreUnused (argc, argv);
+
+    // Benchmarks only make sense in Release builds, debug builds are an order of magnitude slower
+   #if JUCE_DEBUG
+    std::cout << "Warning: running benchmarks in a Debug build" << std::endl;
+   #endif
+
+    runWavetableOscillatorBenchmarks();
+    runPhaseModeBenchmarks();
+    runInterpolationBenchmarks();
+    runWavetableSynthBenchmarks();
+    runSimpleEQBenchmarks();
+
+    return 0;
+}
@@ -0,0 +1,199 @@
+#include "Benchmark.h"
+#include "../../SimpleEQ/Source/StereoFilterCascade.h"
+
+namespace
+{
+	constexpr auto SAMPLE_RATE = 48000.0;
+	// every repetition processes about this many samples per channel, whatever the block size
+	constexpr auto SAMPLES_PER_REPETITION = 1 << 16;
+	/* Both paths run the same transposed direct form II on the same normalized coefficients, so apart from the
+	 * compiler contracting a multiply and an add differently they produce the same samples
+	 */
+	constexpr auto MAX_DIFFERENCE = 1.0e-4f;
+
+	/* The signal path that SimpleEQ used before the fused cascade: one ProcessorChain of juce::dsp::IIR::Filter
+	 * per channel, with the stages that the slopes do not use bypassed.
+	 */
+	using Filter = juce::dsp::IIR::Filter<float>;
+	using CutFilter = juce::dsp::ProcessorChain<Filter, Filter, Filter, Filter>;
+	using MonoChain = juce::dsp::ProcessorChain<CutFilter, Filter, CutFilter>;
+
+	template <int Stage>
+	void updateCutStage(CutFilter& cutFilter, const CutCoefficients& cutCoefficients, Slope slope)
+	{
+		*cutFilter.get<Stage>().coefficients = cutCoefficients[Stage];
+		cutFilter.setBypassed<Stage>(Stage > slope);
+	}
+
+	void updateCutFilter(CutFilter& cutFilter, const CutCoefficients& cutCoefficients, Slope slope)
+	{
+		updateCutStage<0>(cutFilter, cutCoefficients, slope);
+		updateCutStage<1>(cutFilter, cutCoefficients, slope);
+		updateCutStage<2>(cutFilter, cutCoefficients, slope);
+		updateCutStage<3>(cutFilter, cutCoefficients, slope);
+	}
+
+	void updateMonoChain(MonoChain& chain, const CoefficientSet& coefficientSet)
+	{
+		updateCutFilter(chain.get<0>(), coefficientSet.lowCut, coefficientSet.lowCutSlope);
+		*chain.get<1>().coefficients = coefficientSet.peak;
+		updateCutFilter(chain.get<2>(), coefficientSet.highCut, coefficientSet.highCutSlope);
+	}
+
+	CoefficientSet makeCoefficientSet(Slope slope)
+	{
+		ChainSettings chainSettings;
+		chainSettings.lowCutFreq = 80.f;
+		chainSettings.highCutFreq = 12000.f;
+		chainSettings.peakFreq = 750.f;
+		chainSettings.peakGainInDecibels = 6.f;
+		chainSettings.peakQuality = 1.f;
+		chainSettings.lowCutSlope = slope;
+		chainSettings.highCutSlope = slope;
+		return designCoefficients(chainSettings, SAMPLE_RATE);
+	}
+
+	juce::AudioBuffer<float> makeNoise(int blockSize)
+	{
+		juce::AudioBuffer<float> buffer{ 2, blockSize };
+		juce::Random random{ 1 };
+
+		for (auto channel = 0; channel < buffer.getNumChannels(); ++channel)
+		{
+			for (auto sample = 0; sample < blockSize; ++sample)
+			{
+				buffer.setSample(channel, sample, 2.f * random.nextFloat() - 1.f);
+			}
+		}
+
+		return buffer;
+	}
+
+	// the reference path, one prepared ProcessorChain per channel
+	struct StereoProcessorChain
+	{
+		StereoProcessorChain(Slope slope, int blockSize)
+		{
+			const auto coefficientSet = makeCoefficientSet(slope);
+			updateMonoChain(leftChain, coefficientSet);
+			updateMonoChain(rightChain, coefficientSet);
+
+			juce::dsp::ProcessSpec spec{ SAMPLE_RATE, static_cast<juce::uint32>(blockSize), 1 };
+			leftChain.prepare(spec);
+			rightChain.prepare(spec);
+		}
+
+		void process(juce::AudioBuffer<float>& buffer)
+		{
+			juce::dsp::AudioBlock<float> audioBlock{ buffer };
+			auto leftBlock = audioBlock.getSingleChannelBlock(0);
+			auto rightBlock = audioBlock.getSingleChannelBlock(1);
+			leftChain.process(juce::dsp::ProcessContextReplacing<float>{ leftBlock });
+			rightChain.process(juce::dsp::ProcessContextReplacing<float>{ rightBlock });
+		}
+
+		MonoChain leftChain;
+		MonoChain rightChain;
+	};
+
+	/* Filters the same noise through both paths from silence, block after block, and returns the largest absolute
+	 * difference between their outputs, so that the timings below are known to compare equivalent work.
+	 */
+	float maximumDifference(Slope slope, int blockSize)
+	{
+		StereoProcessorChain processorChain{ slope, blockSize };
+		StereoFilterCascade filterCascade;
+		filterCascade.setCoefficients(makeCoefficientSet(slope));
+
+		const auto noise = makeNoise(blockSize);
+		juce::AudioBuffer<float> expected{ 2, blockSize };
+		juce::AudioBuffer<float> actual{ 2, blockSize };
+		auto difference = 0.f;
+
+		for (auto samplesFiltered = 0; samplesFiltered < static_cast<int>(SAMPLE_RATE); samplesFiltered += blockSize)
+		{
+			expected.makeCopyOf(noise, true);
+			actual.makeCopyOf(noise, true);
+			processorChain.process(expected);
+			filterCascade.process(juce::dsp::AudioBlock<float>{ actual });
+
+			for (auto channel = 0; channel < 2; ++channel)
+			{
+				for (auto sample = 0; sample < blockSize; ++sample)
+				{
+					difference = std::max(difference,
+						std::abs(expected.getSample(channel, sample) - actual.getSample(channel, sample)));
+				}
+			}
+		}
+
+		return difference;
+	}
+
+	// returns nanoseconds per stereo sample
+	double measureProcessorChain(Slope slope, int blockSize)
+	{
+		StereoProcessorChain processorChain{ slope, blockSize };
+
+		auto buffer = makeNoise(blockSize);
+		const auto numBlocks = std::max(1, SAMPLES_PER_REPETITION / blockSize);
+
+		return Benchmark::measureNanoseconds([&]
+		{
+			for (auto block = 0; block < numBlocks; ++block)
+			{
+				processorChain.process(buffer);
+				Benchmark::doNotOptimizeAway(buffer.getReadPointer(1), blockSize);
+			}
+		}) / (static_cast<double>(numBlocks) * blockSize);
+	}
+
+	double measureStereoFilterCascade(Slope slope, int blockSize)
+	{
+		StereoFilterCascade filterCascade;
+		filterCascade.setCoefficients(makeCoefficientSet(slope));
+
+		auto buffer = makeNoise(blockSize);
+		const auto numBlocks = std::max(1, SAMPLES_PER_REPETITION / blockSize);
+
+		return Benchmark::measureNanoseconds([&]
+		{
+			for (auto block = 0; block < numBlocks; ++block)
+			{
+				filterCascade.process(juce::dsp::AudioBlock<float>{ buffer });
+				Benchmark::doNotOptimizeAway(buffer.getReadPointer(1), blockSize);
+			}
+		}) / (static_cast<double>(numBlocks) * blockSize);
+	}
+}
+
+/* SimpleEQ: the two ProcessorChains against the fused StereoFilterCascade, with both cuts at the same slope, one
+ * CSV row per slope and block size. The figures are nanoseconds per stereo sample, the speedup is chain / cascade.
+ * Both paths run without denormals, like in processBlock(). A row whose outputs differ by more than MAX_DIFFERENCE
+ * is reported on stderr and asserts in debug builds.
+ */
+void runSimpleEQBenchmarks()
+{
+	std::cout << "SimpleEQ: filter chain benchmarks" << std::endl;
+	std::cout << "slope,blockSize,processorChainNsPerSample,cascadeNsPerSample,speedup,maxDifference" << std::endl;
+
+	const juce::ScopedNoDenormals noDenormals;
+
+	for (const auto slope : { Slope_12, Slope_24, Slope_36, Slope_48 })
+	{
+		for (const auto blockSize : { 64, 512 })
+		{
+			const auto processorChain = measureProcessorChain(slope, blockSize);
+			const auto cascade = measureStereoFilterCascade(slope, blockSize);
+			const auto difference = maximumDifference(slope, blockSize);
+			std::cout << 12 * (slope + 1) << "," << blockSize << "," << processorChain << "," << cascade << ","
+				<< processorChain / cascade << "," << difference << std::endl;
+
+			if (difference > MAX_DIFFERENCE)
+			{
+				std::cerr << "SimpleEQ: the cascade differs from the ProcessorChains by " << difference << std::endl;
+				jassertfalse;
+			}
+		}
+	}
+}
@@ -0,0 +1,255 @@
+#include "Benchmark.h"
+#include "../../WavetableSynth/Source/WavetableOscillator.h"
+#include "../../WavetableSynth/Source/WavetableVoiceBank.h"
+
+namespace
+{
+	constexpr auto SAMPLE_RATE = 96000.0;
+	/* The voice bank holds its notes at k / 2^18 of the sample rate. For k below 2^24 / 375 such a frequency is a
+	 * float, and so is the fraction of the sample rate, so its phase increment is exactly k * 2^14 and the
+	 * reference at the same frequency is exact for it. The float index would not drift at these frequencies
+	 * either, so the oscillator holds the nominal frequency.
+	 */
+	constexpr auto PHASE_BITS = 18;
+
+	std::vector<float> generateSineWaveTable(int length)
+	{
+		std::vector<float> sineWaveTable(static_cast<size_t>(length));
+
+		for (auto i = 0; i < length; ++i)
+		{
+			sineWaveTable[static_cast<size_t>(i)] = std::sin(juce::MathConstants<float>::twoPi * static_cast<float>(i) / static_cast<float>(length));
+		}
+
+		return sineWaveTable;
+	}
+
+	// per-sample reference path, i.e. what WavetableSynth::render() used to do
+	void renderPerSample(WavetableOscillator& oscillator, float* output, int numSamples)
+	{
+		for (auto sample = 0; sample < numSamples; ++sample)
+		{
+			output[sample] += oscillator.getSample();
+		}
+	}
+
+	/* Renders a few seconds with both paths from identical starting states and returns the largest absolute
+	 * difference between them, so that the timings below are known to compare equivalent work.
+	 */
+	float maximumDifference(const Wavetable::Ptr& waveTable, float frequency, int blockSize)
+	{
+		WavetableOscillator perSample{ waveTable, SAMPLE_RATE };
+		WavetableOscillator block{ waveTable, SAMPLE_RATE };
+		perSample.setFrequency(frequency);
+		block.setFrequency(frequency);
+
+		std::vector<float> expected(static_cast<size_t>(blockSize));
+		std::vector<float> actual(static_cast<size_t>(blockSize));
+		auto difference = 0.f;
+
+		for (auto samplesRendered = 0; samplesRendered < 4 * static_cast<int>(SAMPLE_RATE); samplesRendered += blockSize)
+		{
+			std::fill(expected.begin(), expected.end(), 0.f);
+			std::fill(actual.begin(), actual.end(), 0.f);
+			renderPerSample(perSample, expected.data(), blockSize);
+			block.render(actual.data(), blockSize);
+
+			for (auto i = 0; i < blockSize; ++i)
+			{
+				difference = std::max(difference, std::abs(expected[static_cast<size_t>(i)] - actual[static_cast<size_t>(i)]));
+			}
+		}
+
+		return difference;
+	}
+
+	// the odd multiple of SAMPLE_RATE / 2^PHASE_BITS next to frequency, see PHASE_BITS
+	float toExactFrequency(float frequency)
+	{
+		const auto step = std::llround(frequency / SAMPLE_RATE * (1 << PHASE_BITS)) | 1;
+		return static_cast<float>(SAMPLE_RATE * static_cast<double>(step) / (1 << PHASE_BITS));
+	}
+
+	/* Linear interpolation of the table at the exact phase of sample number sampleNumber, computed in double
+	 * precision from the sample number. This reference cannot drift, no matter how long the note is held.
+	 */
+	float referenceSample(const Wavetable& waveTable, double frequency, juce::int64 sampleNumber)
+	{
+		const auto size = static_cast<double>(waveTable.getSize());
+		const auto exactIndex = std::fmod(static_cast<double>(sampleNumber) * frequency * size / SAMPLE_RATE, size);
+		const auto truncatedIndex = static_cast<int>(exactIndex);
+		const auto nextIndexWeight = exactIndex - truncatedIndex;
+
+		return static_cast<float>((1.0 - nextIndexWeight) * waveTable.getSamples()[truncatedIndex]
+			+ nextIndexWeight * waveTable.getSamples()[truncatedIndex + 1]);
+	}
+
+	struct HeldNoteResult
+	{
+		double nanosecondsPerSample;
+		float maximumError;
+	};
+
+	/* Holds one note for the given number of seconds, rendering it with render(output, BLOCK_SIZE), and measures
+	 * the error of the last block against the reference.
+	 */
+	template <typename Render>
+	HeldNoteResult holdNote(const Wavetable::Ptr& waveTable, float frequency, int seconds, Render&& render)
+	{
+		constexpr auto BLOCK_SIZE = 512;
+
+		std::vector<float> output(BLOCK_SIZE);
+		const auto numBlocks = seconds * static_cast<int>(SAMPLE_RATE) / BLOCK_SIZE;
+
+		const auto start = juce::Time::getHighResolutionTicks();
+		for (auto block = 0; block < numBlocks; ++block)
+		{
+			std::fill(output.begin(), output.end(), 0.f);
+			render(output.data(), BLOCK_SIZE);
+		}
+		const auto ticks = juce::Time::getHighResolutionTicks() - start;
+		Benchmark::doNotOptimizeAway(output.data(), BLOCK_SIZE);
+
+		auto maximumError = 0.f;
+		const auto firstSampleOfLastBlock = static_cast<juce::int64>(numBlocks - 1) * BLOCK_SIZE;
+		for (auto i = 0; i < BLOCK_SIZE; ++i)
+		{
+			const auto expected = referenceSample(*waveTable, frequency, firstSampleOfLastBlock + i);
+			maximumError = std::max(maximumError, std::abs(expected - output[static_cast<size_t>(i)]));
+		}
+
+		const auto nanoseconds = 1.0e9 * static_cast<double>(ticks) / static_cast<double>(juce::Time::getHighResolutionTicksPerSecond());
+		return { nanoseconds / (static_cast<double>(numBlocks) * BLOCK_SIZE), maximumError };
+	}
+
+	HeldNoteResult holdOscillatorNote(const Wavetable::Ptr& waveTable, float frequency, int seconds)
+	{
+		WavetableOscillator oscillator{ waveTable, SAMPLE_RATE };
+		oscillator.setFrequency(frequency);
+
+		return holdNote(waveTable, frequency, seconds, [&](float* output, int numSamples)
+		{
+			oscillator.render(output, numSamples);
+		});
+	}
+
+	// a single centred voice has a gain of 1 in the mono mix, and the attack is long over by the last block
+	HeldNoteResult holdVoiceBankNote(const Wavetable::Ptr& waveTable, float frequency, int seconds)
+	{
+		WavetableVoiceBank voiceBank;
+		voiceBank.exchangeWaveTable(waveTable);
+		voiceBank.setSampleRate(SAMPLE_RATE);
+		voiceBank.startVoice(69, frequency);
+
+		return holdNote(waveTable, frequency, seconds, [&](float* output, int numSamples)
+		{
+			voiceBank.render(output, nullptr, numSamples);
+		});
+	}
+}
+
+/* Compares the float index of WavetableOscillator, the per-voice reference model, with the 32-bit fixed-point phase
+ * of the WavetableVoiceBank lanes across the keyboard (A0, A4, C8) and for increasingly long held notes. The error
+ * columns show how far each has drifted from the exact phase by the end of the note.
+ */
+void runPhaseModeBenchmarks()
+{
+	const Wavetable::Ptr waveTable{ new Wavetable{ generateSineWaveTable(64) } };
+
+	std::cout << "WavetableOscillator (reference model) float index vs WavetableVoiceBank fixed-point phase" << std::endl;
+	std::cout << "frequency,heldSeconds,floatNsPerSample,fixedNsPerSample,floatMaxError,fixedMaxError" << std::endl;
+
+	for (const auto frequency : { 27.5f, 440.f, 4186.01f })
+	{
+		for (const auto seconds : { 1, 10, 100 })
+		{
+			const auto floatResult = holdOscillatorNote(waveTable, frequency, seconds);
+			const auto fixedResult = holdVoiceBankNote(waveTable, toExactFrequency(frequency), seconds);
+
+			std::cout << frequency << "," << seconds << "," << floatResult.nanosecondsPerSample << ","
+				<< fixedResult.nanosecondsPerSample << "," << floatResult.maximumError << ","
+				<< fixedResult.maximumError << std::endl;
+		}
+	}
+}
+
+void runWavetableOscillatorBenchmarks()
+{
+	constexpr auto VOICES = 64;
+	constexpr auto BLOCKS_PER_REPETITION = 100;
+
+	const Wavetable::Ptr waveTable{ new Wavetable{ generateSineWaveTable(64) } };
+
+	std::cout << "WavetableOscillator (reference model): getSample() loop vs render(), and WavetableVoiceBank::render()"
+		<< std::endl;
+	std::cout << "blockSize,frequency,perSampleNsPerSample,blockNsPerSample,speedup,maxDifference,voiceBankNsPerSample"
+		<< std::endl;
+
+	for (const auto blockSize : { 32, 64, 256, 1024 })
+	{
+		for (const auto frequency : { 55.f, 440.f, 3520.f })
+		{
+			/* A chord of VOICES oscillators is summed into one buffer, which is the situation in
+			 * WavetableSynth::render() that this block API was written for. The voice bank plays the same chord in its
+			 * lanes, which is how the plugin renders it.
+			 */
+			std::vector<WavetableOscillator> oscillators(VOICES, WavetableOscillator{ waveTable, SAMPLE_RATE });
+			for (auto voice = 0; voice < VOICES; ++voice)
+			{
+				oscillators[static_cast<size_t>(voice)].setFrequency(frequency * (1.f + 0.01f * static_cast<float>(voice)));
+			}
+
+			std::vector<float> output(static_cast<size_t>(blockSize));
+			const auto samplesPerRepetition = static_cast<double>(VOICES * BLOCKS_PER_REPETITION * blockSize);
+
+			const auto perSampleNs = Benchmark::measureNanoseconds([&]
+			{
+				for (auto block = 0; block < BLOCKS_PER_REPETITION; ++block)
+				{
+					std::fill(output.begin(), output.end(), 0.f);
+					for (auto& oscillator : oscillators)
+					{
+						renderPerSample(oscillator, output.data(), blockSize);
+					}
+					Benchmark::doNotOptimizeAway(output.data(), blockSize);
+				}
+			}) / samplesPerRepetition;
+
+			const auto blockNs = Benchmark::measureNanoseconds([&]
+			{
+				for (auto block = 0; block < BLOCKS_PER_REPETITION; ++block)
+				{
+					std::fill(output.begin(), output.end(), 0.f);
+					for (auto& oscillator : oscillators)
+					{
+						oscillator.render(output.data(), blockSize);
+					}
+					Benchmark::doNotOptimizeAway(output.data(), blockSize);
+				}
+			}) / samplesPerRepetition;
+
+			WavetableVoiceBank voiceBank;
+			voiceBank.exchangeWaveTable(waveTable);
+			voiceBank.setSampleRate(SAMPLE_RATE);
+			voiceBank.setPolyphony(VOICES);
+			for (auto voice = 0; voice < VOICES; ++voice)
+			{
+				voiceBank.startVoice(voice, frequency * (1.f + 0.01f * static_cast<float>(voice)));
+			}
+
+			const auto voiceBankNs = Benchmark::measureNanoseconds([&]
+			{
+				for (auto block = 0; block < BLOCKS_PER_REPETITION; ++block)
+				{
+					std::fill(output.begin(), output.end(), 0.f);
+					voiceBank.render(output.data(), nullptr, blockSize);
+					Benchmark::doNotOptimizeAway(output.data(), blockSize);
+				}
+			}) / samplesPerRepetition;
+
+			std::cout << blockSize << "," << frequency << "," << perSampleNs << "," << blockNs << ","
+				<< perSampleNs / blockNs << "," << maximumDifference(waveTable, frequency, blockSize) << ","
+				<< voiceBankNs << std::endl;
+		}
+	}
+}
@@ -0,0 +1,210 @@
+#include "Benchmark.h"
+#include "../../WavetableSynth/Source/WavetableOscillator.h"
+#include "../../WavetableSynth/Source/WavetableSynth.h"
+
+namespace
+{
+	constexpr auto DEFAULT_VOICES = 32;
+	constexpr auto DEFAULT_BLOCK_SIZE = 512;
+	constexpr auto DEFAULT_SAMPLE_RATE = 48000.0;
+	// every repetition renders about this many samples, whatever the block size
+	constexpr auto SAMPLES_PER_REPETITION = 1 << 16;
+
+	struct Configuration
+	{
+		int numVoices = DEFAULT_VOICES;
+		int blockSize = DEFAULT_BLOCK_SIZE;
+		int eventsPerBlock = 0;
+		double sampleRate = DEFAULT_SAMPLE_RATE;
+		bool isFiltered = false;
+		int numRoutings = 0;
+	};
+
+	/* The cycle counts are derived from the time and the nominal clock of the CPU. With turbo or power saving the
+	 * real clock differs, but the figures stay comparable between runs on the same machine.
+	 */
+	double toCyclesPerVoiceSample(double nanosecondsPerSample, int numVoices)
+	{
+		return nanosecondsPerSample * juce::SystemStats::getCpuSpeedInMegahertz() / 1000.0 / numVoices;
+	}
+
+	void printResult(const char* benchmark, const Configuration& configuration, double nanosecondsPerSample)
+	{
+		std::cout << benchmark << "," << configuration.numVoices << "," << configuration.blockSize << ","
+			<< configuration.eventsPerBlock << "," << configuration.sampleRate << "," << nanosecondsPerSample << ","
+			<< toCyclesPerVoiceSample(nanosecondsPerSample, configuration.numVoices) << std::endl;
+	}
+
+	/* Holds numVoices notes and measures processBlock() with eventsPerBlock note-ons spread evenly over every
+	 * block. The note-ons retrigger notes that are already held, so the number of playing voices stays the same
+	 * and the events only add the cost of handleMidiEvent() and of splitting render() at the event positions.
+	 */
+	double measureProcessBlock(const Configuration& configuration)
+	{
+		WavetableSynth synth;
+		synth.setPolyphony(configuration.numVoices);
+		synth.prepareToPlay(configuration.sampleRate);
+
+		// a resonant low pass whose cutoff follows the key and the envelope, so it is recomputed every control block
+		if (configuration.isFiltered)
+		{
+			WavetableVoiceBank::Filter filter;
+			filter.mode = WavetableVoiceBank::Filter::Mode::lowPass;
+			filter.cutoffHz = 1000.f;
+			filter.resonance = 0.5f;
+			filter.keyTracking = 0.5f;
+			filter.envelopeOctaves = 2.f;
+			synth.setFilter(filter);
+		}
+
+		// the first numRoutings of these are routed, each from its own source to its own destination
+		using Source = WavetableVoiceBank::ModulationSource;
+		using Destination = WavetableVoiceBank::ModulationDestination;
+		struct Routing
+		{
+			Source source;
+			Destination destination;
+			float amount;
+		};
+
+		const Routing routings[] = {
+			{ Source::lfo1, Destination::pitch, 0.2f },
+			{ Source::lfo2, Destination::level, 0.5f },
+			{ Source::velocity, Destination::filterCutoff, 2.f },
+			{ Source::envelope, Destination::tablePosition, 1.f }
+		};
+
+		for (auto routing = 0; routing < configuration.numRoutings; ++routing)
+		{
+			synth.setModulation(routings[routing].source, routings[routing].destination, routings[routing].amount);
+		}
+
+		synth.setLfo(1, { WavetableVoiceBank::Lfo::Shape::triangle, 3.f });
+
+		juce::AudioBuffer<float> buffer{ 2, configuration.blockSize };
+		juce::MidiBuffer midiMessages;
+
+		// the first block starts the notes, it is not timed
+		constexpr auto LOWEST_NOTE = 0;
+		for (auto voice = 0; voice < configuration.numVoices; ++voice)
+		{
+			midiMessages.addEvent(juce::MidiMessage::noteOn(1, LOWEST_NOTE + voice, 0.5f), 0);
+		}
+		buffer.clear();
+		synth.processBlock(buffer, midiMessages);
+
+		midiMessages.clear();
+		for (auto event = 0; event < configuration.eventsPerBlock; ++event)
+		{
+			const auto note = LOWEST_NOTE + event % configuration.numVoices;
+			const auto samplePosition = event * configuration.blockSize / configuration.eventsPerBlock;
+			midiMessages.addEvent(juce::MidiMessage::noteOn(1, note, 0.5f), samplePosition);
+		}
+
+		const auto numBlocks = std::max(1, SAMPLES_PER_REPETITION / configuration.blockSize);
+
+		return Benchmark::measureNanoseconds([&]
+		{
+			for (auto block = 0; block < numBlocks; ++block)
+			{
+				buffer.clear();
+				synth.processBlock(buffer, midiMessages);
+				Benchmark::doNotOptimizeAway(buffer.getReadPointer(0), configuration.blockSize);
+			}
+		}) / (static_cast<double>(numBlocks) * configuration.blockSize);
+	}
+
+	// the per-sample path of a single WavetableOscillator, one getSample() call per sample
+	double measureGetSample(const Configuration& configuration)
+	{
+		std::vector<float> sineWaveTable(2048);
+		for (size_t i = 0; i < sineWaveTable.size(); ++i)
+		{
+			sineWaveTable[i] = std::sin(juce::MathConstants<float>::twoPi * static_cast<float>(i) / static_cast<float>(sineWaveTable.size()));
+		}
+
+		const Wavetable::Ptr waveTable{ new Wavetable{ sineWaveTable } };
+		WavetableOscillator oscillator{ waveTable, configuration.sampleRate };
+		oscillator.setFrequency(440.f);
+
+		std::vector<float> output(static_cast<size_t>(configuration.blockSize));
+		const auto numBlocks = std::max(1, SAMPLES_PER_REPETITION / configuration.blockSize);
+
+		return Benchmark::measureNanoseconds([&]
+		{
+			for (auto block = 0; block < numBlocks; ++block)
+			{
+				for (auto& sample : output)
+				{
+					sample = oscillator.getSample();
+				}
+				Benchmark::doNotOptimizeAway(output.data(), configuration.blockSize);
+			}
+		}) / (static_cast<double>(numBlocks) * configuration.blockSize);
+	}
+}
+
+/* The engine benchmarks, one CSV row per measurement so that runs of different releases can be diffed:
+ * - render: processBlock() without MIDI events over a grid of voice counts and block sizes,
+ * - midi: the same with 1 to 256 events per block, the difference to 0 events is the cost of the events,
+ * - sampleRate: render at 44.1 to 192 kHz,
+ * - filter: render with a modulated low pass on every voice, the difference to render is the cost of the filter,
+ * - modulationN: render with N routings of the modulation matrix, the cost should grow with N only,
+ * - getSample: WavetableOscillator::getSample(), the per-voice reference model, on its own at the same sample rates.
+ * The columns that a benchmark does not vary are at their defaults (32 voices, 512 samples, 48 kHz).
+ */
+void runWavetableSynthBenchmarks()
+{
+	std::cout << "WavetableSynth: engine benchmarks" << std::endl;
+	std::cout << "benchmark,voices,blockSize,eventsPerBlock,sampleRate,nsPerSample,cyclesPerVoiceSample" << std::endl;
+
+	for (const auto numVoices : { 1, 8, 32, 64, 128 })
+	{
+		for (const auto blockSize : { 16, 64, 256, 1024, 4096 })
+		{
+			Configuration configuration;
+			configuration.numVoices = numVoices;
+			configuration.blockSize = blockSize;
+			printResult("render", configuration, measureProcessBlock(configuration));
+		}
+	}
+
+	for (const auto eventsPerBlock : { 0, 1, 16, 64, 256 })
+	{
+		Configuration configuration;
+		configuration.eventsPerBlock = eventsPerBlock;
+		printResult("midi", configuration, measureProcessBlock(configuration));
+	}
+
+	for (const auto sampleRate : { 44100.0, 48000.0, 96000.0, 192000.0 })
+	{
+		Configuration configuration;
+		configuration.sampleRate = sampleRate;
+		printResult("sampleRate", configuration, measureProcessBlock(configuration));
+	}
+
+	for (const auto numVoices : { 8, 32, 64, 128 })
+	{
+		Configuration configuration;
+		configuration.numVoices = numVoices;
+		configuration.isFiltered = true;
+		printResult("filter", configuration, measureProcessBlock(configuration));
+	}
+
+	for (const auto numRoutings : { 0, 1, 2, 4 })
+	{
+		Configuration configuration;
+		configuration.numRoutings = numRoutings;
+		// the CSV has no column for the routings, so they are part of the name
+		const auto benchmark = "modulation" + std::to_string(numRoutings);
+		printResult(benchmark.c_str(), configuration, measureProcessBlock(configuration));
+	}
+
+	for (const auto sampleRate : { 44100.0, 48000.0, 96000.0, 192000.0 })
+	{
+		Configuration configuration;
+		configuration.numVoices = 1;
+		configuration.sampleRate = sampleRate;
+		printResult("getSample", configuration, measureGetSample(configuration));
+	}
+}
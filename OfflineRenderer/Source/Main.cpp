@@ -0,0 +1,71 @@
+/*
+  ==============================================================================
+
+    This file contains the basic startup code for a JUCE application.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <iostream>
+#include "OfflineRender.h"
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    const juce::ArgumentList arguments (argc, argv);
+
+    if (arguments.size() < 2)
+    {
+        std::cout << "Usage: " << arguments.executableName << " <input.mid> <output.wav>"
+                  << " [--sample-rate=48000] [--block-size=512] [--tail=2] [--workers=0] [--bits=24]" << std::endl;
+        return 1;
+    }
+
+    OfflineRender::Settings settings;
+
+    // an option that is not given keeps its default
+    const auto getOption = [&arguments] (const juce::String& option, const juce::String& defaultValue)
+    {
+        const auto value = arguments.getValueForOption (option);
+        return value.isNotEmpty() ? value : defaultValue;
+    };
+
+    settings.sampleRate = getOption ("--sample-rate", juce::String (settings.sampleRate)).getDoubleValue();
+    settings.blockSize = getOption ("--block-size", juce::String (settings.blockSize)).getIntValue();
+    settings.tailSeconds = getOption ("--tail", juce::String (settings.tailSeconds)).getDoubleValue();
+    settings.numRenderWorkers = getOption ("--workers", juce::String (settings.numRenderWorkers)).getIntValue();
+    settings.bitsPerSample = getOption ("--bits", juce::String (settings.bitsPerSample)).getIntValue();
+
+    if (settings.sampleRate <= 0.0 || settings.blockSize <= 0 || settings.tailSeconds < 0.0 || settings.numRenderWorkers < 0)
+    {
+        std::cout << "Invalid settings" << std::endl;
+        return 1;
+    }
+
+   #if JUCE_DEBUG
+    std::cout << "Warning: timing a Debug build" << std::endl;
+   #endif
+
+    OfflineRender::Statistics statistics;
+    const auto result = OfflineRender::render (arguments[0].resolveAsFile(), arguments[1].resolveAsFile(),
+                                               settings, statistics);
+
+    if (result.failed())
+    {
+        std::cout << result.getErrorMessage() << std::endl;
+        return 1;
+    }
+
+    const auto renderedSeconds = static_cast<double> (statistics.numSamples) / settings.sampleRate;
+    const auto blockSeconds = static_cast<double> (settings.blockSize) / settings.sampleRate;
+
+    std::cout << "Rendered " << renderedSeconds << " s in " << statistics.numBlocks << " blocks of "
+              << settings.blockSize << " samples at " << settings.sampleRate << " Hz" << std::endl;
+    std::cout << "Processing time: " << statistics.processingSeconds << " s, real-time factor "
+              << renderedSeconds / statistics.processingSeconds << std::endl;
+    std::cout << "Peak block: " << 1.0e6 * statistics.peakBlockSeconds << " us, "
+              << 100.0 * statistics.peakBlockSeconds / blockSeconds << " % of the block duration" << std::endl;
+
+    return 0;
+}
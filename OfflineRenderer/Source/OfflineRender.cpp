@@ -0,0 +1,140 @@
+#include "OfflineRender.h"
+#include "../../WavetableSynth/Source/AudioThreadGuard.h"
+#include "../../WavetableSynth/Source/WavetableSynth.h"
+
+namespace
+{
+	// the tracks of the file merged into one sequence, with time stamps in seconds
+	juce::Result readMidiFile(const juce::File& file, juce::MidiMessageSequence& sequence)
+	{
+		juce::FileInputStream stream{ file };
+
+		if (!stream.openedOk())
+		{
+			return juce::Result::fail("Could not open " + file.getFullPathName());
+		}
+
+		juce::MidiFile midiFile;
+
+		if (!midiFile.readFrom(stream))
+		{
+			return juce::Result::fail(file.getFullPathName() + " is not a Standard MIDI File");
+		}
+
+		midiFile.convertTimestampTicksToSeconds();
+
+		for (auto track = 0; track < midiFile.getNumTracks(); ++track)
+		{
+			sequence.addSequence(*midiFile.getTrack(track), 0.0);
+		}
+
+		return juce::Result::ok();
+	}
+
+	std::unique_ptr<juce::AudioFormatWriter> createWavWriter(const juce::File& file,
+		const OfflineRender::Settings& settings)
+	{
+		file.deleteFile();
+		std::unique_ptr<juce::FileOutputStream> stream{ file.createOutputStream() };
+
+		if (stream == nullptr)
+		{
+			return nullptr;
+		}
+
+		juce::WavAudioFormat wavFormat;
+		std::unique_ptr<juce::AudioFormatWriter> writer{ wavFormat.createWriterFor(stream.get(), settings.sampleRate,
+			2, settings.bitsPerSample, {}, 0) };
+
+		// the writer owns the stream from now on
+		if (writer != nullptr)
+		{
+			stream.release();
+		}
+
+		return writer;
+	}
+}
+
+juce::Result OfflineRender::render(const juce::File& midiFile, const juce::File& wavFile, const Settings& settings,
+	Statistics& statistics)
+{
+	juce::MidiMessageSequence sequence;
+	const auto readResult = readMidiFile(midiFile, sequence);
+
+	if (readResult.failed())
+	{
+		return readResult;
+	}
+
+	auto writer = createWavWriter(wavFile, settings);
+
+	if (writer == nullptr)
+	{
+		return juce::Result::fail("Could not create " + wavFile.getFullPathName());
+	}
+
+	WavetableSynth synth;
+	synth.setNumRenderWorkers(settings.numRenderWorkers);
+	synth.prepareToPlay(settings.sampleRate);
+
+	// everything the loop needs is allocated up front, like a host does before it starts processing
+	juce::AudioBuffer<float> buffer{ 2, settings.blockSize };
+	juce::MidiBuffer midiMessages;
+	midiMessages.ensureSize(4096);
+
+	const auto totalSamples = static_cast<juce::int64>(std::ceil((sequence.getEndTime() + settings.tailSeconds)
+		* settings.sampleRate));
+	const auto ticksPerSecond = static_cast<double>(juce::Time::getHighResolutionTicksPerSecond());
+	auto eventIndex = 0;
+	statistics = {};
+
+	for (juce::int64 blockStart = 0; blockStart < totalSamples; blockStart += settings.blockSize)
+	{
+		const auto numSamples = static_cast<int>(std::min<juce::int64>(settings.blockSize, totalSamples - blockStart));
+
+		// the events of this block, at their sample positions relative to the start of the block
+		midiMessages.clear();
+		for (; eventIndex < sequence.getNumEvents(); ++eventIndex)
+		{
+			const auto& message = sequence.getEventPointer(eventIndex)->message;
+			const auto eventSample = static_cast<juce::int64>(std::llround(message.getTimeStamp() * settings.sampleRate));
+
+			if (eventSample >= blockStart + numSamples)
+			{
+				break;
+			}
+
+			// tempo, time signature and other meta events only matter for the conversion to seconds
+			if (!message.isMetaEvent())
+			{
+				midiMessages.addEvent(message, static_cast<int>(std::max<juce::int64>(0, eventSample - blockStart)));
+			}
+		}
+
+		buffer.setSize(2, numSamples, false, false, true);
+
+		const auto start = juce::Time::getHighResolutionTicks();
+		{
+			// the same conditions as in WavetableSynthAudioProcessor::processBlock()
+			const AudioThreadGuard audioThreadGuard;
+			juce::ScopedNoDenormals noDenormals;
+
+			buffer.clear();
+			synth.processBlock(buffer, midiMessages);
+		}
+		const auto blockSeconds = static_cast<double>(juce::Time::getHighResolutionTicks() - start) / ticksPerSecond;
+
+		statistics.processingSeconds += blockSeconds;
+		statistics.peakBlockSeconds = std::max(statistics.peakBlockSeconds, blockSeconds);
+		++statistics.numBlocks;
+		statistics.numSamples += numSamples;
+
+		if (!writer->writeFromAudioSampleBuffer(buffer, 0, numSamples))
+		{
+			return juce::Result::fail("Could not write to " + wavFile.getFullPathName());
+		}
+	}
+
+	return juce::Result::ok();
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <JuceHeader.h>
+
+/*
+ * Bounces a Standard MIDI File through WavetableSynth::processBlock() as fast as the engine can go, e.g. for
+ * regression tests and batch asset generation. The engine is driven exactly like a host would drive the plugin:
+ * one processBlock() call per block of blockSize samples, with the MIDI events of the block at their sample
+ * positions. Every block is written to the WAV file as soon as it is rendered, so the memory use does not depend on
+ * the length of the file.
+ * Only the processBlock() calls are timed, reading the MIDI file and writing the WAV file are not part of the
+ * figures.
+ */
+namespace OfflineRender
+{
+	struct Settings
+	{
+		double sampleRate = 48000.0;
+		int blockSize = 512;
+		// rendered after the last MIDI event, so that released notes can fade out
+		double tailSeconds = 2.0;
+		int numRenderWorkers = 0;
+		int bitsPerSample = 24;
+	};
+
+	struct Statistics
+	{
+		juce::int64 numSamples = 0;
+		int numBlocks = 0;
+		double processingSeconds = 0.0;
+		double peakBlockSeconds = 0.0;
+	};
+
+	juce::Result render(const juce::File& midiFile, const juce::File& wavFile, const Settings& settings,
+		Statistics& statistics);
+}
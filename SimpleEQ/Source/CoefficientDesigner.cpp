@@ -0,0 +1,72 @@
+#include "CoefficientDesigner.h"
+
+CoefficientDesigner::CoefficientDesigner(juce::AudioProcessorValueTreeState& apvts)
+    : juce::Thread{ "SimpleEQ Coefficient Designer" },
+    apvts{ apvts }
+{
+}
+
+CoefficientDesigner::~CoefficientDesigner()
+{
+    stopThread(1000);
+}
+
+CoefficientSet CoefficientDesigner::prepare(double sampleRate)
+{
+    /* The host does not call processBlock() while it prepares us, so with the thread stopped nobody else touches
+     * the slots. A set for the old sample rate that was never taken is dropped here.
+     */
+    stopThread(1000);
+    middleSlot = middleSlot.load() & SLOT_MASK;
+    designRequested = false;
+    this->sampleRate = sampleRate;
+
+    startThread(juce::Thread::Priority::normal);
+
+    return designCoefficients(getChainSettings(apvts), sampleRate);
+}
+
+void CoefficientDesigner::release()
+{
+    stopThread(1000);
+}
+
+void CoefficientDesigner::requestDesign()
+{
+    // the event stays signalled until run() waits on it, so a request during a design is not lost
+    designRequested = true;
+
+    if (juce::MessageManager::existsAndIsCurrentThread())
+        notify();
+}
+
+const CoefficientSet* CoefficientDesigner::takePublishedSet()
+{
+    if ((middleSlot.load() & NEW_SET) == 0)
+        return nullptr;
+
+    // the slot that we read last goes back into the middle, the designer thread will write it again
+    readSlot = middleSlot.exchange(readSlot) & SLOT_MASK;
+    return &slots[readSlot];
+}
+
+void CoefficientDesigner::run()
+{
+    while (!threadShouldExit())
+    {
+        // the parameters are read when the design starts, a change during the design requests the next one
+        if (designRequested.exchange(false))
+        {
+            slots[writeSlot] = designCoefficients(getChainSettings(apvts), sampleRate);
+            publish();
+        }
+
+        wait(POLL_INTERVAL_MS);
+    }
+}
+
+void CoefficientDesigner::publish()
+{
+    // the finished slot goes into the middle, and whichever slot was there (taken or not) is written next
+    writeSlot = middleSlot.exchange(writeSlot | NEW_SET) & SLOT_MASK;
+}
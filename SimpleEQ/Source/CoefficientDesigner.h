@@ -0,0 +1,60 @@
+#pragma once
+
+#include "EqCoefficients.h"
+
+/*
+ * Designs the coefficients of the EQ on a background thread and hands them over to the audio thread without
+ * locks and without allocations.
+ *
+ * The sets live in three preallocated slots that are used as a triple buffer: the designer thread writes one
+ * slot, the audio thread reads another and the third holds the newest finished set. Publishing swaps the slot
+ * that was just written with the one in the middle, taking swaps the slot that was just read with it. An
+ * atomic index tells which slot is in the middle and whether it holds a set that has not been taken yet, so in
+ * a block without a new set the audio thread only makes a single atomic load.
+ */
+class CoefficientDesigner : private juce::Thread
+{
+public:
+    explicit CoefficientDesigner(juce::AudioProcessorValueTreeState& apvts);
+    ~CoefficientDesigner() override;
+
+    /* Called from prepareToPlay(): starts the designer thread and returns the set for the new sample rate right
+     * away, so the first block does not have to wait for the thread.
+     */
+    CoefficientSet prepare(double sampleRate);
+    // called from releaseResources(), the thread is not needed while the plugin does not play
+    void release();
+
+    /* Called from any thread when a parameter changed, including the audio thread during automation. Only on the
+     * message thread does it wake the designer thread, since that takes the mutex of the thread's event. From any
+     * other thread the request waits for the next poll of the designer thread, at most POLL_INTERVAL_MS later.
+     */
+    void requestDesign();
+
+    // audio thread: returns the newest set once, or nullptr if there is nothing new
+    const CoefficientSet* takePublishedSet();
+
+private:
+    static constexpr int NUM_SLOTS = 3;
+    // set in the middle index when the slot holds a set that the audio thread has not taken yet
+    static constexpr int NEW_SET = 4;
+    static constexpr int SLOT_MASK = 3;
+    // how often the designer thread looks for requests that could not wake it
+    static constexpr int POLL_INTERVAL_MS = 10;
+
+    void run() override;
+    void publish();
+
+    juce::AudioProcessorValueTreeState& apvts;
+
+    std::atomic<double> sampleRate{ 44100.0 };
+    std::atomic<bool> designRequested{ false };
+
+    std::array<CoefficientSet, NUM_SLOTS> slots;
+    // only the designer thread touches writeSlot, only the audio thread touches readSlot
+    int writeSlot = 0;
+    std::atomic<int> middleSlot{ 1 };
+    int readSlot = 2;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(CoefficientDesigner)
+};
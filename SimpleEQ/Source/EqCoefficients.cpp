@@ -0,0 +1,38 @@
+#include "EqCoefficients.h"
+
+namespace
+{
+    /* The same Butterworth design as FilterDesign::designIIRHighpassHighOrderButterworthMethod() and its low pass
+     * counterpart: a slope of 12 * n dB/Oct is a cascade of n biquads at the cutoff, whose qualities place their
+     * poles evenly on the Butterworth circle. Only the first n entries are used.
+     */
+    CutCoefficients makeCutCoefficients(float frequency, Slope slope, double sampleRate, bool isHighPass)
+    {
+        CutCoefficients cutCoefficients{};
+        const auto order = 2 * (slope + 1);
+
+        for (int i = 0; i < order / 2; ++i)
+        {
+            const auto quality = static_cast<float>(1.0 / (2.0 * std::cos((2.0 * i + 1.0) * juce::MathConstants<double>::pi / (order * 2.0))));
+            cutCoefficients[i] = isHighPass
+                ? juce::dsp::IIR::ArrayCoefficients<float>::makeHighPass(sampleRate, frequency, quality)
+                : juce::dsp::IIR::ArrayCoefficients<float>::makeLowPass(sampleRate, frequency, quality);
+        }
+
+        return cutCoefficients;
+    }
+}
+
+CoefficientSet designCoefficients(const ChainSettings& chainSettings, double sampleRate)
+{
+    CoefficientSet coefficientSet;
+
+    coefficientSet.lowCut = makeCutCoefficients(chainSettings.lowCutFreq, chainSettings.lowCutSlope, sampleRate, true);
+    coefficientSet.peak = juce::dsp::IIR::ArrayCoefficients<float>::makePeakFilter(sampleRate, chainSettings.peakFreq,
+        chainSettings.peakQuality, juce::Decibels::decibelsToGain(chainSettings.peakGainInDecibels));
+    coefficientSet.highCut = makeCutCoefficients(chainSettings.highCutFreq, chainSettings.highCutSlope, sampleRate, false);
+    coefficientSet.lowCutSlope = chainSettings.lowCutSlope;
+    coefficientSet.highCutSlope = chainSettings.highCutSlope;
+
+    return coefficientSet;
+}
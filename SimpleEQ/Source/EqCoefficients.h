@@ -0,0 +1,53 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <juce_dsp/juce_dsp.h>
+enum Slope
+{
+	Slope_12,
+    Slope_24,
+    Slope_36,
+    Slope_48
+};
+
+
+
+/* We want to extract our parameters from the AudioProcessorValueTreeState.
+ * A data structure representing all of the parameter values will keep our code readable
+ */
+
+struct ChainSettings
+{
+    float peakFreq{ 0 }, peakGainInDecibels{ 0 }, peakQuality{ 1.f };
+    float lowCutFreq{ 0 }, highCutFreq{ 0 };
+    Slope lowCutSlope{Slope::Slope_12 }, highCutSlope{ Slope::Slope_12};
+};
+
+/* Declared, not included, so that the Benchmarks app can use the rest of this header without
+ * juce_audio_processors
+ */
+namespace juce { class AudioProcessorValueTreeState; }
+
+/* A helper function that will give us all of these parameter values in our data structure */
+ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts);
+
+/* The ArrayCoefficients helpers return the biquad coefficients by value in a std::array, so unlike the
+ * Coefficients::make... and FilterDesign functions designing them does not allocate. A cut filter is a cascade
+ * of up to 4 biquads, of which the slope selects the first 1 to 4.
+ */
+using BiquadCoefficients = std::array<float, 6>;
+using CutCoefficients = std::array<BiquadCoefficients, 4>;
+
+/* Everything that the three bands of one chain need, designed for one sample rate */
+struct CoefficientSet
+{
+    CutCoefficients lowCut{};
+    BiquadCoefficients peak{};
+    CutCoefficients highCut{};
+    Slope lowCutSlope{ Slope::Slope_12 }, highCutSlope{ Slope::Slope_12 };
+};
+
+/* Designs every band of the EQ for chainSettings. It neither allocates nor locks, so it can be called on any
+ * thread.
+ */
+CoefficientSet designCoefficients(const ChainSettings& chainSettings, double sampleRate);
@@ -22,10 +22,24 @@ SimpleEQAudioProcessor::SimpleEQAudioProcessor()
                        )
 #endif
 {
+    apvts.addParameterListener("LowCut Freq", this);
+    apvts.addParameterListener("LowCut Slope", this);
+    apvts.addParameterListener("HighCut Freq", this);
+    apvts.addParameterListener("HighCut Slope", this);
+    apvts.addParameterListener("Peak Freq", this);
+    apvts.addParameterListener("Peak Gain", this);
+    apvts.addParameterListener("Peak Quality", this);
 }
 
 SimpleEQAudioProcessor::~SimpleEQAudioProcessor()
 {
+    apvts.removeParameterListener("LowCut Freq", this);
+    apvts.removeParameterListener("LowCut Slope", this);
+    apvts.removeParameterListener("HighCut Freq", this);
+    apvts.removeParameterListener("HighCut Slope", this);
+    apvts.removeParameterListener("Peak Freq", this);
+    apvts.removeParameterListener("Peak Gain", this);
+    apvts.removeParameterListener("Peak Quality", this);
 }
 
 //==============================================================================
@@ -96,47 +110,22 @@ void SimpleEQAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlo
     // Use this method as the place to do any pre-playback
     // initialisation that you need..
 
-    /* Here we prepare our filters before we use them and we do this by passing
-     * a ProcessSpec object to the chains which will then pass it to each link in the chain.
-     * Here we need the maximum number of samples that we will process at one time,
-     * the number of channels and sampleRate.
-     */
-
-    juce::dsp::ProcessSpec spec;
-    spec.maximumBlockSize= samplesPerBlock;
-    spec.numChannels = 1;
-    spec.sampleRate = sampleRate;
-
-    /* We can pass ProcessSpec type spec to each chain and will be prepared and ready for processing */
+    juce::ignoreUnused(samplesPerBlock);
 
-    leftChain.prepare(spec);
-    rightChain.prepare(spec);
-
-    /* Having our settings we can start producing coefficients using the static helper that are part of the IIR
-     * coefficients class.
+    /* The cascade processes the samples one by one and needs no buffers, so all it needs is to start from
+     * silence. The sample rate may have changed, so the designer gives us a set for the new one right away and
+     * designs any later change on its own thread.
      */
 
-    auto chainSettings = getChainSettings(apvts);
-
-    updatePeakFilter(chainSettings);
-    auto cutCoefficients = juce::dsp::FilterDesign<float>::designIIRHighpassHighOrderButterworthMethod(chainSettings.lowCutFreq, sampleRate, 2 * (chainSettings.lowCutSlope + 1));
-
-    auto& leftLowCut = leftChain.get<ChainPositions::LowCut>();
-
-    updateCutFilter(leftLowCut, cutCoefficients, chainSettings.lowCutSlope);
-    
-
-    
-
-    auto& rightLowCut = rightChain.get<ChainPositions::LowCut>();
-    updateCutFilter(rightLowCut, cutCoefficients, chainSettings.lowCutSlope);
-
+    filterCascade.reset();
+    filterCascade.setCoefficients(coefficientDesigner.prepare(sampleRate));
 }
 
 void SimpleEQAudioProcessor::releaseResources()
 {
     // When playback stops, you can use this as an opportunity to free up any
     // spare memory, etc.
+    coefficientDesigner.release();
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -167,11 +156,8 @@ bool SimpleEQAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts)
 
 void SimpleEQAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
-    /* Processor chain requires a processing context to be passed to it in order to run
-     * the audio through the links in the chain. In order to make a processing context, we need to supply it
-     * with an audio block instance. Now the processBlock() function is called by the host and it is given
-     * a buffer which can have any number of channels, so we need to extract the left channel and the right
-     * channel from this buffer. L(0) R(1).
+    /* The processBlock() function is called by the host and it is given a buffer which can have any number of
+     * channels. The layouts that we support have one or two, L(0) R(1), and the cascade filters them together.
      */
 
     juce::ScopedNoDenormals noDenormals;
@@ -187,58 +173,17 @@ void SimpleEQAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juc
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear (i, 0, buffer.getNumSamples());
 
-    auto chainSettings = getChainSettings(apvts);
-
-    updatePeakFilter(chainSettings);
-
-    auto cutCoefficients = juce::dsp::FilterDesign<float>::designIIRHighpassHighOrderButterworthMethod(chainSettings.lowCutFreq, getSampleRate(), 2 * (chainSettings.lowCutSlope + 1));
-
-    auto& leftLowCut = leftChain.get<ChainPositions::LowCut>();
-
-    updateCutFilter(leftLowCut, cutCoefficients, chainSettings.lowCutSlope);
-
-    auto& rightLowCut = rightChain.get<ChainPositions::LowCut>();
-    updateCutFilter(rightLowCut, cutCoefficients, chainSettings.lowCutSlope);
-
-
-
-
+    /* The coefficients are designed on the designer thread whenever a parameter changed, here we only pick up
+     * the newest set. In a block without a new set this costs a single atomic load.
+     */
+    if (auto* coefficientSet = coefficientDesigner.takePublishedSet())
+        filterCascade.setCoefficients(*coefficientSet);
 
     /* First thing we have to do is to create an AudioBlock initialized with our buffer */
     juce::dsp::AudioBlock<float> block(buffer);
 
-
-    // This is the place where you'd normally do the guts of your plugin's
-    // audio processing...
-    // Make sure to reset the state if your inner loop is processing
-    // the samples and the outer loop is handling the channels.
-    // Alternatively, you can process the samples with the channels
-    // interleaved by keeping the same state.
-    /*
-     for (int channel = 0; channel < totalNumInputChannels; ++channel)
-    {
-        auto* channelData = buffer.getWritePointer (channel);
-
-        // ..do something to the data...
-    }
-    */
-
-    /* Now we can use the helper function in the AudioBlock class to extract individual channels from the buffer
-     * which will then be wrapped inside more audio blocks.
-     */
-
-    auto leftBlock = block.getSingleChannelBlock(0);
-    auto rightBlock = block.getSingleChannelBlock(1);
-
-    /* Now that we have audio blocks representing each individual channel we can create processing contexts
-     * that wrap each individual audio block for the channels.
-     */
-    juce::dsp::ProcessContextReplacing<float> leftContext(leftBlock);
-    juce::dsp::ProcessContextReplacing<float> rightContext(rightBlock);
-    /* Now we can pass the above contexts to our mono filter chains */
-    leftChain.process(leftContext);
-    rightChain.process(rightContext);
-
+    /* One pass over the buffer runs every sample of both channels through the whole chain */
+    filterCascade.process(block.getSubsetChannelBlock(0, static_cast<size_t>(totalNumInputChannels)));
 }
 
 //==============================================================================
@@ -290,18 +235,11 @@ ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts)
 	return settings;
 }
 
-void SimpleEQAudioProcessor::updatePeakFilter(const ChainSettings& chainSettings)
+void SimpleEQAudioProcessor::parameterChanged(const juce::String& parameterID, float newValue)
 {
-    auto peakCoefficients = juce::dsp::IIR::Coefficients<float>::makePeakFilter(getSampleRate(), chainSettings.peakFreq,
-        chainSettings.peakQuality, juce::Decibels::decibelsToGain(chainSettings.peakGainInDecibels));
-
-    updateCoefficients(leftChain.get<ChainPositions::Peak>().coefficients, peakCoefficients);
-    updateCoefficients(rightChain.get<ChainPositions::Peak>().coefficients, peakCoefficients);
-}
+    juce::ignoreUnused(parameterID, newValue);
 
-void SimpleEQAudioProcessor::updateCoefficients(Coefficients& old, const Coefficients& replacements)
-{
-    *old = *replacements;
+    coefficientDesigner.requestDesign();
 }
 
 
@@ -0,0 +1,136 @@
+#include "StereoFilterCascade.h"
+
+void StereoFilterCascade::setCoefficients(const CoefficientSet& coefficientSet)
+{
+    // a slope of 12 * n dB/Oct uses the first n stages of its cut
+    for (int i = 0; i < NUM_CUT_STAGES; ++i)
+    {
+        setStage(FIRST_LOW_CUT_STAGE + i, coefficientSet.lowCut[i], i <= coefficientSet.lowCutSlope);
+        setStage(FIRST_HIGH_CUT_STAGE + i, coefficientSet.highCut[i], i <= coefficientSet.highCutSlope);
+    }
+
+    setStage(PEAK_STAGE, coefficientSet.peak, true);
+
+    numActiveStages = 0;
+
+    for (int stage = 0; stage < NUM_STAGES; ++stage)
+    {
+        if (isStageActive[stage])
+            activeStages[numActiveStages++] = stage;
+    }
+}
+
+void StereoFilterCascade::setStage(int stage, const BiquadCoefficients& coefficients, bool isActive)
+{
+    // a stage that was bypassed starts from silence, not from the state that it had when it was bypassed
+    if (isActive && !isStageActive[stage])
+    {
+        state1s[stage].fill(0.f);
+        state2s[stage].fill(0.f);
+    }
+
+    isStageActive[stage] = isActive;
+
+    if (!isActive)
+        return;
+
+    // the coefficients come as b0, b1, b2, a0, a1, a2
+    const auto a0Inverse = 1.f / coefficients[3];
+    stageCoefficients[stage] = { coefficients[0] * a0Inverse, coefficients[1] * a0Inverse,
+        coefficients[2] * a0Inverse, coefficients[4] * a0Inverse, coefficients[5] * a0Inverse };
+}
+
+void StereoFilterCascade::reset()
+{
+    for (auto& state : state1s)
+        state.fill(0.f);
+    for (auto& state : state2s)
+        state.fill(0.f);
+}
+
+void StereoFilterCascade::process(const juce::dsp::AudioBlock<float>& block)
+{
+    const auto numChannels = static_cast<int>(block.getNumChannels());
+    const auto numSamples = block.getNumSamples();
+    jassert(numChannels <= MAX_CHANNELS);
+
+    std::array<float*, MAX_CHANNELS> channels{};
+    for (int channel = 0; channel < numChannels; ++channel)
+        channels[channel] = block.getChannelPointer(static_cast<size_t>(channel));
+
+#if JUCE_USE_SIMD
+    using Vector = juce::dsp::SIMDRegister<float>;
+
+    /* The coefficients are broadcast to every lane and the states are loaded once per block, so the loop below
+     * only gathers the channels of a sample into a register, runs it through every active stage and scatters it
+     * back. The lanes without a channel carry silence and keep their state at 0.
+     */
+    Vector coefficients[NUM_STAGES][NUM_COEFFICIENTS];
+    Vector state1[NUM_STAGES];
+    Vector state2[NUM_STAGES];
+
+    for (int i = 0; i < numActiveStages; ++i)
+    {
+        const auto stage = activeStages[i];
+
+        for (int coefficient = 0; coefficient < NUM_COEFFICIENTS; ++coefficient)
+            coefficients[i][coefficient] = Vector::expand(stageCoefficients[stage][coefficient]);
+
+        state1[i] = Vector::fromRawArray(state1s[stage].data());
+        state2[i] = Vector::fromRawArray(state2s[stage].data());
+    }
+
+    alignas(64) float frame[MAX_CHANNELS]{};
+
+    for (size_t sample = 0; sample < numSamples; ++sample)
+    {
+        for (int channel = 0; channel < numChannels; ++channel)
+            frame[channel] = channels[channel][sample];
+
+        auto value = Vector::fromRawArray(frame);
+
+        for (int i = 0; i < numActiveStages; ++i)
+            value = processStage(value, coefficients[i], state1[i], state2[i]);
+
+        value.copyToRawArray(frame);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            channels[channel][sample] = frame[channel];
+    }
+
+    for (int i = 0; i < numActiveStages; ++i)
+    {
+        state1[i].copyToRawArray(state1s[activeStages[i]].data());
+        state2[i].copyToRawArray(state2s[activeStages[i]].data());
+    }
+#else
+    // without SIMD the channels run one after the other, still in one pass through all stages per channel
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        float state1[NUM_STAGES];
+        float state2[NUM_STAGES];
+
+        for (int i = 0; i < numActiveStages; ++i)
+        {
+            state1[i] = state1s[activeStages[i]][channel];
+            state2[i] = state2s[activeStages[i]][channel];
+        }
+
+        for (size_t sample = 0; sample < numSamples; ++sample)
+        {
+            auto value = channels[channel][sample];
+
+            for (int i = 0; i < numActiveStages; ++i)
+                value = processStage(value, stageCoefficients[activeStages[i]].data(), state1[i], state2[i]);
+
+            channels[channel][sample] = value;
+        }
+
+        for (int i = 0; i < numActiveStages; ++i)
+        {
+            state1s[activeStages[i]][channel] = state1[i];
+            state2s[activeStages[i]][channel] = state2[i];
+        }
+    }
+#endif
+}
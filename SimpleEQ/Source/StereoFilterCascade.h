@@ -0,0 +1,59 @@
+#pragma once
+
+#include "EqCoefficients.h"
+
+/*
+ * The whole signal path of the EQ (LowCut -> Peak -> HighCut) as one cascade of biquads that processes all
+ * channels at once. The channels of a sample sit side by side in one SIMD register (left and right, or up to 4
+ * channels with SSE and NEON), so every stage costs the same few vector operations for the stereo pair as it
+ * would for a single channel, and the whole cascade runs in one pass over the buffer with its state in registers.
+ * Both channels share one copy of the coefficients. Stages that the slopes bypass are skipped entirely.
+ */
+class StereoFilterCascade
+{
+public:
+#if JUCE_USE_SIMD
+    static constexpr int MAX_CHANNELS = static_cast<int>(juce::dsp::SIMDRegister<float>::SIMDNumElements);
+#else
+    static constexpr int MAX_CHANNELS = 2;
+#endif
+
+    // can be called between two process() calls, the stages keep their state unless the slope just enabled them
+    void setCoefficients(const CoefficientSet& coefficientSet);
+    void reset();
+    // filters the first channels of block in place, block must not have more than MAX_CHANNELS channels
+    void process(const juce::dsp::AudioBlock<float>& block);
+
+private:
+    static constexpr int NUM_CUT_STAGES = 4;
+    static constexpr int FIRST_LOW_CUT_STAGE = 0;
+    static constexpr int PEAK_STAGE = FIRST_LOW_CUT_STAGE + NUM_CUT_STAGES;
+    static constexpr int FIRST_HIGH_CUT_STAGE = PEAK_STAGE + 1;
+    static constexpr int NUM_STAGES = FIRST_HIGH_CUT_STAGE + NUM_CUT_STAGES;
+    // b0, b1, b2, a1 and a2, divided by a0
+    static constexpr int NUM_COEFFICIENTS = 5;
+
+    void setStage(int stage, const BiquadCoefficients& coefficients, bool isActive);
+
+    /* One sample through one biquad in transposed direct form II, the same structure as juce::dsp::IIR::Filter.
+     * A template over the value type, so that the same code runs on floats and on SIMD registers.
+     */
+    template <typename Value>
+    static Value processStage(Value input, const Value* coefficients, Value& state1, Value& state2)
+    {
+        const auto output = coefficients[0] * input + state1;
+        state1 = coefficients[1] * input - coefficients[3] * output + state2;
+        state2 = coefficients[2] * input - coefficients[4] * output;
+        return output;
+    }
+
+    std::array<std::array<float, NUM_COEFFICIENTS>, NUM_STAGES> stageCoefficients{};
+    std::array<bool, NUM_STAGES> isStageActive{};
+    // the active stages in signal order, which are all that process() visits
+    std::array<int, NUM_STAGES> activeStages{};
+    int numActiveStages = 0;
+
+    // the two states of every stage, one lane per channel
+    alignas(64) std::array<std::array<float, MAX_CHANNELS>, NUM_STAGES> state1s{};
+    alignas(64) std::array<std::array<float, MAX_CHANNELS>, NUM_STAGES> state2s{};
+};
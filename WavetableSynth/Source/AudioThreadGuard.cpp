@@ -0,0 +1,207 @@
+#include "AudioThreadGuard.h"
+
+#if JUCE_DEBUG
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <utility>
+
+namespace
+{
+	// how many guards are alive on this thread, guards may be nested
+	thread_local int audioThreadGuardDepth = 0;
+}
+
+AudioThreadGuard::AudioThreadGuard()
+{
+	++audioThreadGuardDepth;
+}
+
+AudioThreadGuard::~AudioThreadGuard()
+{
+	--audioThreadGuardDepth;
+}
+
+bool AudioThreadGuard::isAudioThread()
+{
+	return audioThreadGuardDepth > 0;
+}
+
+void AudioThreadGuard::assertNotOnAudioThread()
+{
+	if (isAudioThread())
+	{
+		/* The assertion itself may log and allocate, so we leave the audio thread state while it runs,
+		 * otherwise we would end up here again.
+		 */
+		const auto depth = std::exchange(audioThreadGuardDepth, 0);
+		jassertfalse;
+		audioThreadGuardDepth = depth;
+	}
+}
+
+/* Replacements of the global allocation functions, in every form that C++17 lets a program replace: plain and
+ * array, aligned (std::align_val_t) and nothrow. They behave like the default ones, except that they check that they
+ * are not called from a thread that is marked as the audio thread. Placement new does not allocate, so the
+ * language does not let it be replaced and it is not checked.
+ */
+namespace
+{
+	void* allocateOrNull(std::size_t size)
+	{
+		AudioThreadGuard::assertNotOnAudioThread();
+		return std::malloc(size == 0 ? 1 : size);
+	}
+
+	/* std::aligned_alloc is missing on MSVC and wants a multiple of the alignment as size, so an aligned block is
+	 * carved out of a larger malloc() block instead, with the pointer to that block stored right in front of it.
+	 */
+	void* allocateAlignedOrNull(std::size_t size, std::align_val_t alignment)
+	{
+		AudioThreadGuard::assertNotOnAudioThread();
+
+		const auto alignmentInBytes = std::max(static_cast<std::size_t>(alignment), alignof(void*));
+		auto* block = static_cast<char*>(std::malloc(size + alignmentInBytes + sizeof(void*)));
+
+		if (block == nullptr)
+		{
+			return nullptr;
+		}
+
+		const auto address = reinterpret_cast<std::uintptr_t>(block + sizeof(void*));
+		auto* memory = reinterpret_cast<char*>((address + alignmentInBytes - 1) & ~(alignmentInBytes - 1));
+		reinterpret_cast<void**>(memory)[-1] = block;
+		return memory;
+	}
+
+	void deallocate(void* memory)
+	{
+		if (memory != nullptr)
+		{
+			AudioThreadGuard::assertNotOnAudioThread();
+		}
+
+		std::free(memory);
+	}
+
+	void deallocateAligned(void* memory)
+	{
+		if (memory != nullptr)
+		{
+			AudioThreadGuard::assertNotOnAudioThread();
+			std::free(reinterpret_cast<void**>(memory)[-1]);
+		}
+	}
+}
+
+void* operator new(std::size_t size)
+{
+	if (auto* memory = allocateOrNull(size))
+	{
+		return memory;
+	}
+
+	throw std::bad_alloc{};
+}
+
+void* operator new[](std::size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	return allocateOrNull(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+	return allocateOrNull(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+	if (auto* memory = allocateAlignedOrNull(size, alignment))
+	{
+		return memory;
+	}
+
+	throw std::bad_alloc{};
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+	return operator new(size, alignment);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return allocateAlignedOrNull(size, alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return allocateAlignedOrNull(size, alignment);
+}
+
+void operator delete(void* memory) noexcept
+{
+	deallocate(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+	deallocate(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+	deallocate(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept
+{
+	deallocate(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept
+{
+	deallocate(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept
+{
+	deallocate(memory);
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept
+{
+	deallocateAligned(memory);
+}
+
+void operator delete[](void* memory, std::align_val_t) noexcept
+{
+	deallocateAligned(memory);
+}
+
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept
+{
+	deallocateAligned(memory);
+}
+
+void operator delete[](void* memory, std::size_t, std::align_val_t) noexcept
+{
+	deallocateAligned(memory);
+}
+
+void operator delete(void* memory, std::align_val_t, const std::nothrow_t&) noexcept
+{
+	deallocateAligned(memory);
+}
+
+void operator delete[](void* memory, std::align_val_t, const std::nothrow_t&) noexcept
+{
+	deallocateAligned(memory);
+}
+#endif
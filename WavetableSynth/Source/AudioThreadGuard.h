@@ -0,0 +1,30 @@
+#pragma once
+#include "JuceHeader.h"
+
+/*
+ * The audio thread must never allocate memory or take a lock, because both may block for an unbounded time.
+ * In debug builds an AudioThreadGuard marks the current thread as the audio thread for as long as it lives, and
+ * AudioThreadGuard.cpp replaces every form of the global operator new and delete (plain, array, aligned and
+ * nothrow) so that any allocation or deallocation on a marked thread hits an assertion. Code that takes a lock
+ * calls assertNotOnAudioThread() before doing so.
+ * In release builds the guard compiles to nothing.
+ */
+class AudioThreadGuard
+{
+public:
+#if JUCE_DEBUG
+	AudioThreadGuard();
+	~AudioThreadGuard();
+
+	static bool isAudioThread();
+	static void assertNotOnAudioThread();
+#else
+	AudioThreadGuard() = default;
+
+	static bool isAudioThread() { return false; }
+	static void assertNotOnAudioThread() {}
+#endif
+
+private:
+	JUCE_DECLARE_NON_COPYABLE(AudioThreadGuard)
+};
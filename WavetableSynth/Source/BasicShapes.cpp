@@ -0,0 +1,116 @@
+#include "BasicShapes.h"
+
+namespace
+{
+	constexpr auto PI = 3.14159265358979323846;
+
+	/* std::sin is not constexpr, so we use its Taylor series. The argument is brought into [-pi, pi] first, where
+	 * 20 terms are accurate far beyond float precision.
+	 */
+	constexpr double constexprSin(double x)
+	{
+		while (x > PI)
+		{
+			x -= 2.0 * PI;
+		}
+
+		while (x < -PI)
+		{
+			x += 2.0 * PI;
+		}
+
+		auto term = x;
+		auto sum = x;
+
+		for (auto n = 1; n < 20; ++n)
+		{
+			term *= -x * x / static_cast<double>((2 * n) * (2 * n + 1));
+			sum += term;
+		}
+
+		return sum;
+	}
+
+	using SineTable = std::array<double, BasicShapes::SIZE>;
+
+	// one period of a sine, harmonic h of sample i is sineTable[(h * i) % SIZE]
+	constexpr SineTable generateSineTable()
+	{
+		SineTable sineTable{};
+
+		for (auto i = 0; i < BasicShapes::SIZE; ++i)
+		{
+			sineTable[i] = constexprSin(2.0 * PI * i / BasicShapes::SIZE);
+		}
+
+		return sineTable;
+	}
+
+	constexpr auto SINE_TABLE = generateSineTable();
+
+	// the amplitude of harmonic h in the Fourier series of the shape
+	constexpr double getHarmonicAmplitude(BasicShapes::Shape shape, int h)
+	{
+		switch (shape)
+		{
+		case BasicShapes::Shape::sine:
+			return h == 1 ? 1.0 : 0.0;
+		case BasicShapes::Shape::triangle:
+			// odd harmonics with alternating signs, falling with 1 / h^2
+			return h % 2 == 1 ? ((h / 2) % 2 == 0 ? 1.0 : -1.0) * 8.0 / (PI * PI * h * h) : 0.0;
+		case BasicShapes::Shape::saw:
+			// a ramp from -1 up to 1
+			return -2.0 / (PI * h);
+		case BasicShapes::Shape::square:
+			return h % 2 == 1 ? 4.0 / (PI * h) : 0.0;
+		}
+
+		return 0.0;
+	}
+
+	constexpr BasicShapes::Levels generateLevels(BasicShapes::Shape shape)
+	{
+		BasicShapes::Levels levels{};
+
+		for (auto level = 0; level < BasicShapes::NUM_LEVELS; ++level)
+		{
+			const auto highestHarmonic = (BasicShapes::SIZE / 2) >> level;
+
+			for (auto i = 0; i < BasicShapes::SIZE; ++i)
+			{
+				auto sample = 0.0;
+
+				for (auto h = 1; h <= highestHarmonic; ++h)
+				{
+					sample += getHarmonicAmplitude(shape, h) * SINE_TABLE[(h * i) % BasicShapes::SIZE];
+				}
+
+				levels[level][i] = static_cast<float>(sample);
+			}
+		}
+
+		return levels;
+	}
+
+	constexpr BasicShapes::Levels SINE_LEVELS = generateLevels(BasicShapes::Shape::sine);
+	constexpr BasicShapes::Levels TRIANGLE_LEVELS = generateLevels(BasicShapes::Shape::triangle);
+	constexpr BasicShapes::Levels SAW_LEVELS = generateLevels(BasicShapes::Shape::saw);
+	constexpr BasicShapes::Levels SQUARE_LEVELS = generateLevels(BasicShapes::Shape::square);
+}
+
+const BasicShapes::Levels& BasicShapes::getLevels(Shape shape)
+{
+	switch (shape)
+	{
+	case Shape::sine:
+		return SINE_LEVELS;
+	case Shape::triangle:
+		return TRIANGLE_LEVELS;
+	case Shape::saw:
+		return SAW_LEVELS;
+	case Shape::square:
+		return SQUARE_LEVELS;
+	}
+
+	return SINE_LEVELS;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <array>
+
+/*
+ * The built-in wave tables: sine, triangle, saw and square. They are computed by the compiler and stored in the
+ * binary, including their band-limited mip levels, so creating or preparing a plugin instance does no
+ * transcendental math and no FFT. Every level is an additive Fourier series that stops at the highest harmonic
+ * of that level, i.e. level k keeps the harmonics up to (SIZE / 2) >> k, like the levels that Wavetable builds
+ * for tables loaded at runtime.
+ * The tables have 64 samples, which keeps each of them well within the evaluation limits of constexpr in all
+ * compilers that build this project.
+ */
+namespace BasicShapes
+{
+	enum class Shape
+	{
+		sine,
+		triangle,
+		saw,
+		square
+	};
+
+	constexpr int NUM_SHAPES = 4;
+	constexpr int SIZE = 64;
+	// levels down to a single harmonic: log2(SIZE / 2) + 1 of them
+	constexpr int NUM_LEVELS = 6;
+	static_assert(((SIZE / 2) >> (NUM_LEVELS - 1)) == 1, "the same levels that Wavetable builds for a table of SIZE");
+
+	using Levels = std::array<std::array<float, SIZE>, NUM_LEVELS>;
+
+	// level 0 first, the samples of all levels are contiguous
+	const Levels& getLevels(Shape shape);
+}
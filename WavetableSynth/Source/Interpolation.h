@@ -0,0 +1,108 @@
+#pragma once
+#include "JuceHeader.h"
+
+/*
+ * The interpolation policies of WavetableOscillator and WavetableVoiceBank. A policy combines NUM_POINTS table
+ * values around the index, out of table[truncatedIndex - 1] ... table[truncatedIndex + 2], using the weight of the
+ * next point, i.e. the fractional part of the index. The guard samples of Wavetable keep all four points inside
+ * the table at both of its ends.
+ * interpolate() is a template over the value type, so the same code runs on floats and on SIMD registers, and the
+ * render loops are templates over the policy. A policy is thus chosen once per block and inlines into the loop
+ * without any branch per sample. Constants are always on the right of an operator, because SIMDRegister only
+ * offers register-float operators in that order.
+ */
+namespace Interpolation
+{
+	enum class Type
+	{
+		none,
+		linear,
+		cubicHermite,
+		lagrange
+	};
+
+	// truncates the index: the cheapest policy, with the most noise and aliasing
+	struct None
+	{
+		static constexpr int NUM_POINTS = 1;
+
+		template <typename Value>
+		static Value interpolate(Value, Value current, Value, Value, Value)
+		{
+			return current;
+		}
+	};
+
+	/* The weighted sum of the two nearest table values. next * w - current * (w - 1) is bit for bit the same as
+	 * (1 - w) * current + w * next, which is what the oscillator has always computed.
+	 */
+	struct Linear
+	{
+		static constexpr int NUM_POINTS = 2;
+
+		template <typename Value>
+		static Value interpolate(Value, Value current, Value next, Value, Value nextWeight)
+		{
+			return next * nextWeight - current * (nextWeight - 1.f);
+		}
+	};
+
+	// the Catmull-Rom spline: continuous in the first derivative, so it droops and aliases less than linear
+	struct CubicHermite
+	{
+		static constexpr int NUM_POINTS = 4;
+
+		template <typename Value>
+		static Value interpolate(Value previous, Value current, Value next, Value afterNext, Value nextWeight)
+		{
+			const auto slope = (next - previous) * 0.5f;
+			const auto curvature = previous - current * 2.5f + next * 2.f - afterNext * 0.5f;
+			const auto jerk = (afterNext - previous) * 0.5f + (current - next) * 1.5f;
+
+			return ((jerk * nextWeight + curvature) * nextWeight + slope) * nextWeight + current;
+		}
+	};
+
+	// the cubic polynomial through all four points at -1, 0, 1 and 2
+	struct Lagrange
+	{
+		static constexpr int NUM_POINTS = 4;
+
+		template <typename Value>
+		static Value interpolate(Value previous, Value current, Value next, Value afterNext, Value nextWeight)
+		{
+			const auto plusOne = nextWeight + 1.f;
+			const auto minusOne = nextWeight - 1.f;
+			const auto minusTwo = nextWeight - 2.f;
+
+			return previous * (nextWeight * minusOne * minusTwo * (-1.f / 6.f))
+				+ current * (plusOne * minusOne * minusTwo * 0.5f)
+				+ next * (plusOne * nextWeight * minusTwo * -0.5f)
+				+ afterNext * (plusOne * nextWeight * minusOne * (1.f / 6.f));
+		}
+	};
+
+	/* Calls function with an instance of the policy for type. The function is usually a generic lambda that
+	 * forwards to a render loop templated on decltype(policy), which turns the runtime choice into a compile-time
+	 * one.
+	 */
+	template <typename Function>
+	void withPolicy(Type type, Function&& function)
+	{
+		switch (type)
+		{
+		case Type::none:
+			function(None{});
+			break;
+		case Type::linear:
+			function(Linear{});
+			break;
+		case Type::cubicHermite:
+			function(CubicHermite{});
+			break;
+		case Type::lagrange:
+			function(Lagrange{});
+			break;
+		}
+	}
+}
@@ -0,0 +1,132 @@
+#include "ModulationMatrix.h"
+
+void ModulationMatrix::setAmount(Source source, Destination destination, float amount)
+{
+	amounts[static_cast<size_t>(source) * NUM_DESTINATIONS + static_cast<size_t>(destination)] = amount;
+
+	numGlobalRoutings = 0;
+	numLaneRoutings = 0;
+	isSourceRouted.fill(false);
+
+	for (auto sourceIndex = 0; sourceIndex < NUM_SOURCES; ++sourceIndex)
+	{
+		for (auto destinationIndex = 0; destinationIndex < NUM_DESTINATIONS; ++destinationIndex)
+		{
+			const auto routingAmount = amounts[static_cast<size_t>(sourceIndex * NUM_DESTINATIONS + destinationIndex)];
+
+			if (routingAmount == 0.f)
+			{
+				continue;
+			}
+
+			const Routing routing{ static_cast<Source>(sourceIndex), static_cast<Destination>(destinationIndex),
+				routingAmount };
+
+			if (isLaneSource(routing.source))
+			{
+				laneRoutings[static_cast<size_t>(numLaneRoutings++)] = routing;
+			}
+			else
+			{
+				globalRoutings[static_cast<size_t>(numGlobalRoutings++)] = routing;
+			}
+
+			isSourceRouted[static_cast<size_t>(sourceIndex)] = true;
+		}
+	}
+}
+
+void ModulationMatrix::setLfo(int lfoIndex, const Lfo& lfo)
+{
+	jassert(lfoIndex >= 0 && lfoIndex < NUM_LFOS);
+	lfos[static_cast<size_t>(lfoIndex)] = lfo;
+}
+
+void ModulationMatrix::setModWheel(float value)
+{
+	modWheel = juce::jlimit(0.f, 1.f, value);
+}
+
+void ModulationMatrix::updateSources(int numSamples, int controlBlockSize, double sampleRate)
+{
+	jassert(numSamples <= MAX_CONTROL_BLOCKS * controlBlockSize);
+
+	for (auto startSample = 0; startSample < numSamples; startSample += controlBlockSize)
+	{
+		std::array<float, NUM_SOURCES> sourceValues{};
+		const auto numControlBlockSamples = std::min(controlBlockSize, numSamples - startSample);
+
+		for (auto lfoIndex = 0; lfoIndex < NUM_LFOS; ++lfoIndex)
+		{
+			const auto& lfo = lfos[static_cast<size_t>(lfoIndex)];
+			auto& phase = lfoPhases[static_cast<size_t>(lfoIndex)];
+			const auto source = static_cast<size_t>(Source::lfo1) + static_cast<size_t>(lfoIndex);
+
+			if (isSourceRouted[source])
+			{
+				switch (lfo.shape)
+				{
+				case Lfo::Shape::sine:
+					sourceValues[source] = std::sin(juce::MathConstants<float>::twoPi * phase);
+					break;
+				case Lfo::Shape::triangle:
+					sourceValues[source] = 1.f - 4.f * std::abs(phase - 0.5f);
+					break;
+				case Lfo::Shape::saw:
+					sourceValues[source] = 2.f * phase - 1.f;
+					break;
+				case Lfo::Shape::square:
+					sourceValues[source] = phase < 0.5f ? 1.f : -1.f;
+					break;
+				}
+			}
+
+			phase += lfo.rateHz * static_cast<float>(numControlBlockSamples) / static_cast<float>(sampleRate);
+			phase -= std::floor(phase);
+		}
+
+		sourceValues[static_cast<size_t>(Source::modWheel)] = modWheel;
+
+		auto& offsets = controlBlockOffsets[static_cast<size_t>(startSample / controlBlockSize)];
+		offsets.fill(0.f);
+
+		for (auto routing = globalRoutings.begin(); routing != globalRoutings.begin() + numGlobalRoutings; ++routing)
+		{
+			addRouting(offsets, *routing, sourceValues[static_cast<size_t>(routing->source)]);
+		}
+	}
+}
+
+ModulationMatrix::Modulation ModulationMatrix::getModulation(int controlBlock, float envelopeLevel,
+	float velocity) const
+{
+	auto modulation = controlBlockOffsets[static_cast<size_t>(controlBlock)];
+
+	for (auto routing = laneRoutings.begin(); routing != laneRoutings.begin() + numLaneRoutings; ++routing)
+	{
+		addRouting(modulation, *routing, routing->source == Source::envelope ? envelopeLevel : velocity);
+	}
+
+	return modulation;
+}
+
+bool ModulationMatrix::isLaneSource(Source source)
+{
+	return source == Source::envelope || source == Source::velocity;
+}
+
+void ModulationMatrix::addRouting(Modulation& modulation, const Routing& routing, float value)
+{
+	const auto isBipolar = routing.source == Source::lfo1 || routing.source == Source::lfo2;
+	auto& destinationModulation = modulation[static_cast<size_t>(routing.destination)];
+
+	// the level is lowered from the full level, by the distance of the source from its highest value
+	if (routing.destination == Destination::level)
+	{
+		destinationModulation -= routing.amount * (isBipolar ? 0.5f * (1.f - value) : 1.f - value);
+	}
+	else
+	{
+		destinationModulation += routing.amount * value;
+	}
+}
@@ -0,0 +1,104 @@
+#pragma once
+#include "JuceHeader.h"
+#include <array>
+
+/*
+ * The modulation matrix of WavetableVoiceBank: it routes two LFOs, the envelope, the velocity and the mod wheel to
+ * the pitch, the table position, the level and the filter cutoff. The LFOs and the mod wheel are the same for
+ * every lane, so their routings are summed once per control block into one offset per destination, before the
+ * render jobs start. A lane then only adds the routings of its own envelope and velocity, and without those the
+ * matrix costs it a copy of the offsets.
+ */
+class ModulationMatrix
+{
+public:
+	enum class Source
+	{
+		// from -1 to 1
+		lfo1,
+		lfo2,
+		// the envelope level of the voice, from 0 to 1
+		envelope,
+		// the velocity of the note-on, from 0 to 1
+		velocity,
+		// from 0 to 1
+		modWheel
+	};
+
+	static constexpr int NUM_SOURCES = 5;
+
+	enum class Destination
+	{
+		// semitones at a source value of 1
+		pitch,
+		// the frame of a multi-frame table, 1 moves from the first to the last frame
+		tablePosition,
+		// at 1 the source scales the level from silence at its lowest value to full level at its highest
+		level,
+		// octaves at a source value of 1
+		filterCutoff
+	};
+
+	static constexpr int NUM_DESTINATIONS = 4;
+
+	struct Lfo
+	{
+		enum class Shape
+		{
+			sine,
+			triangle,
+			saw,
+			square
+		};
+
+		Shape shape = Shape::sine;
+		float rateHz = 1.f;
+	};
+
+	static constexpr int NUM_LFOS = 2;
+	// the most control blocks that one call of updateSources() can cover
+	static constexpr int MAX_CONTROL_BLOCKS = 8;
+
+	// the sum of all routings to every destination
+	using Modulation = std::array<float, NUM_DESTINATIONS>;
+
+	// 0 removes the routing, the cost of the matrix grows with the routings that are not 0
+	void setAmount(Source source, Destination destination, float amount);
+	// the LFOs run freely and are shared by all voices
+	void setLfo(int lfoIndex, const Lfo& lfo);
+	// from 0 to 1
+	void setModWheel(float value);
+
+	/* Sums the routings of the LFOs and the mod wheel for the control blocks of the next numSamples samples, and
+	 * advances the LFOs past them. An LFO that nothing is routed from keeps its phase moving, but is not evaluated.
+	 */
+	void updateSources(int numSamples, int controlBlockSize, double sampleRate);
+	// the modulation of a lane in one of the control blocks of the last updateSources(), safe to call from any job
+	Modulation getModulation(int controlBlock, float envelopeLevel, float velocity) const;
+
+private:
+	struct Routing
+	{
+		Source source;
+		Destination destination;
+		float amount;
+	};
+
+	static bool isLaneSource(Source source);
+	static void addRouting(Modulation& modulation, const Routing& routing, float value);
+
+	// the whole matrix, and the routings in it that are not 0, split by whether their source is global or per lane
+	std::array<float, NUM_SOURCES * NUM_DESTINATIONS> amounts{};
+	std::array<Routing, NUM_SOURCES * NUM_DESTINATIONS> globalRoutings{};
+	int numGlobalRoutings = 0;
+	std::array<Routing, NUM_SOURCES * NUM_DESTINATIONS> laneRoutings{};
+	int numLaneRoutings = 0;
+	std::array<bool, NUM_SOURCES> isSourceRouted{};
+
+	std::array<Lfo, NUM_LFOS> lfos{};
+	// the phase of every LFO as a fraction of its period
+	std::array<float, NUM_LFOS> lfoPhases{};
+	float modWheel = 0.f;
+	// the sum of the global routings for every control block
+	std::array<Modulation, MAX_CONTROL_BLOCKS> controlBlockOffsets{};
+};
@@ -8,6 +8,12 @@
 
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
+#include "AudioThreadGuard.h"
+
+namespace
+{
+    constexpr int MAX_RENDER_THREADS = 15;
+}
 
 //==============================================================================
 WavetableSynthAudioProcessor::WavetableSynthAudioProcessor()
@@ -22,6 +28,8 @@ WavetableSynthAudioProcessor::WavetableSynthAudioProcessor()
                        )
 #endif
 {
+    interpolation = apvts.getRawParameterValue ("Interpolation");
+    renderThreads = apvts.getRawParameterValue ("Render Threads");
 }
 
 WavetableSynthAudioProcessor::~WavetableSynthAudioProcessor()
@@ -63,7 +71,8 @@ bool WavetableSynthAudioProcessor::isMidiEffect() const
 
 double WavetableSynthAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    // the voices keep sounding for their release time after the last note-off
+    return synth.getTailLengthSeconds();
 }
 
 int WavetableSynthAudioProcessor::getNumPrograms()
@@ -93,8 +102,9 @@ void WavetableSynthAudioProcessor::changeProgramName (int index, const juce::Str
 //==============================================================================
 void WavetableSynthAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
-    // Use this method as the place to do any pre-playback
-    // initialisation that you need..
+    // every allocation the synth needs happens here, processBlock() only works on what is prepared
+    synth.setNumRenderWorkers (static_cast<int> (renderThreads->load()));
+    synth.prepareToPlay (sampleRate);
 }
 
 void WavetableSynthAudioProcessor::releaseResources()
@@ -110,12 +120,9 @@ bool WavetableSynthAudioProcessor::isBusesLayoutSupported (const BusesLayout& la
     juce::ignoreUnused (layouts);
     return true;
   #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    // Some plugin hosts, such as certain GarageBand versions, will only
-    // load plugins that support stereo bus layouts.
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
+    // The synth renders mono on a mono bus and stereo into the first two channels of
+    // any larger bus, so every layout with at least one output channel works.
+    if (layouts.getMainOutputChannelSet().isDisabled())
         return false;
 
     // This checks if the input layout matches the output layout
@@ -131,31 +138,17 @@ bool WavetableSynthAudioProcessor::isBusesLayoutSupported (const BusesLayout& la
 
 void WavetableSynthAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
+    // in debug builds, any allocation or lock from here on triggers an assertion
+    const AudioThreadGuard audioThreadGuard;
+
     juce::ScopedNoDenormals noDenormals;
-    auto totalNumInputChannels  = getTotalNumInputChannels();
-    auto totalNumOutputChannels = getTotalNumOutputChannels();
-
-    // In case we have more outputs than inputs, this code clears any output
-    // channels that didn't contain input data, (because these aren't
-    // guaranteed to be empty - they may contain garbage).
-    // This is here to avoid people getting screaming feedback
-    // when they first compile a plugin, but obviously you don't need to keep
-    // this code if your algorithm always overwrites all the output channels.
-    for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
-        buffer.clear (i, 0, buffer.getNumSamples());
-
-    // This is the place where you'd normally do the guts of your plugin's
-    // audio processing...
-    // Make sure to reset the state if your inner loop is processing
-    // the samples and the outer loop is handling the channels.
-    // Alternatively, you can process the samples with the channels
-    // interleaved by keeping the same state.
-    for (int channel = 0; channel < totalNumInputChannels; ++channel)
-    {
-        auto* channelData = buffer.getWritePointer (channel);
-
-        // ..do something to the data...
-    }
+
+    // the synth adds its voices onto the buffer, which may still contain garbage from the host. An idle synth
+    // leaves the cleared buffer alone, so hasBeenCleared() stays true and the wrapper can report silence.
+    buffer.clear();
+
+    synth.setInterpolation (static_cast<Interpolation::Type> (static_cast<int> (interpolation->load())));
+    synth.processBlock (buffer, midiMessages);
 }
 
 //==============================================================================
@@ -172,15 +165,35 @@ juce::AudioProcessorEditor* WavetableSynthAudioProcessor::createEditor()
 //==============================================================================
 void WavetableSynthAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
-    // You should use this method to store your parameters in the memory block.
-    // You could do that either as raw data, or use the XML or ValueTree classes
-    // as intermediaries to make it easy to save and load complex data.
+    if (auto xml = apvts.copyState().createXml())
+        copyXmlToBinary (*xml, destData);
 }
 
 void WavetableSynthAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
-    // You should use this method to restore your parameters from this memory block,
-    // whose contents will have been created by the getStateInformation() call.
+    auto xml = getXmlFromBinary (data, sizeInBytes);
+
+    if (xml != nullptr && xml->hasTagName (apvts.state.getType()))
+        apvts.replaceState (juce::ValueTree::fromXml (*xml));
+}
+
+juce::AudioProcessorValueTreeState::ParameterLayout WavetableSynthAudioProcessor::createParameterLayout()
+{
+    juce::AudioProcessorValueTreeState::ParameterLayout layout;
+
+    // the default is that of the synth, so a new instance sounds the same as the engine on its own
+    layout.add (std::make_unique<juce::AudioParameterChoice> ("Interpolation", "Interpolation",
+        juce::StringArray { "None", "Linear", "Cubic Hermite", "Lagrange" },
+        static_cast<int> (Interpolation::Type::linear)));
+
+    /* The number of worker threads that help the audio thread once enough voices play, 0 renders on the audio
+     * thread only. It is not automatable, because the threads are only started or stopped when the host prepares
+     * the plugin again.
+     */
+    layout.add (std::make_unique<juce::AudioParameterInt> ("Render Threads", "Render Threads", 0,
+        MAX_RENDER_THREADS, 0, juce::AudioParameterIntAttributes{}.withAutomatable (false)));
+
+    return layout;
 }
 
 //==============================================================================
@@ -9,10 +9,12 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "WavetableSynth.h"
 
 //==============================================================================
-/**
-*/
+/* The interpolation of the synth is a parameter of the host, so it can be chosen per preset and is saved with the
+ * project. processBlock() hands the current choice to the synth at the start of every block.
+ */
 class WavetableSynthAudioProcessor  : public juce::AudioProcessor
 {
 public:
@@ -53,7 +55,18 @@ public:
     void getStateInformation (juce::MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
 
+    static juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
+
+    juce::AudioProcessorValueTreeState apvts{ *this, nullptr, "Parameters", createParameterLayout() };
+
 private:
     //==============================================================================
+    WavetableSynth synth;
+
+    // the values of the parameters, looked up once so that the audio thread never builds a parameter ID
+    std::atomic<float>* interpolation;
+    // read in prepareToPlay() only, since starting or stopping threads is no job for the audio thread
+    std::atomic<float>* renderThreads;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (WavetableSynthAudioProcessor)
 };
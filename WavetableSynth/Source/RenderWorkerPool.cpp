@@ -0,0 +1,176 @@
+#include "RenderWorkerPool.h"
+
+#if JUCE_INTEL
+#include <immintrin.h>
+#endif
+
+namespace
+{
+	// tells the core that this is a spin-wait loop, which saves power and lets the other hyperthread run
+	inline void pause()
+	{
+#if JUCE_INTEL
+		_mm_pause();
+#elif JUCE_ARM && JUCE_MSVC
+		__yield();
+#elif JUCE_ARM
+		__asm__ __volatile__("yield");
+#endif
+	}
+}
+
+class RenderWorkerPool::Worker : public juce::Thread
+{
+public:
+	Worker(RenderWorkerPool& pool, int workerIndex)
+		:juce::Thread{ "Render Worker " + juce::String{ workerIndex } },
+		pool{ pool }
+	{
+	}
+
+	~Worker() override
+	{
+		stopThread(1000);
+	}
+
+	/* The audio thread never signals a worker, so a worker notices a batch by the batch number changing. A worker
+	 * that comes back from one millisecond of waiting has missed all batches in between, their jobs ran elsewhere.
+	 */
+	void run() override
+	{
+		auto lastBatch = getBatch(pool.batchState.load());
+		auto lastBatchTime = juce::Time::getMillisecondCounter();
+		auto numSpins = 0;
+
+		while (!threadShouldExit())
+		{
+			const auto state = pool.batchState.load();
+
+			if (getBatch(state) != lastBatch)
+			{
+				lastBatch = getBatch(state);
+				lastBatchTime = juce::Time::getMillisecondCounter();
+				numSpins = 0;
+				pool.runJobs(state);
+			}
+			else if (numSpins < MAX_WORKER_SPINS)
+			{
+				++numSpins;
+				pause();
+			}
+			else if (juce::Time::getMillisecondCounter() - lastBatchTime < YIELD_MILLISECONDS)
+			{
+				yield();
+			}
+			else
+			{
+				wait(1);
+			}
+		}
+	}
+
+private:
+	static juce::uint32 getBatch(juce::uint64 state)
+	{
+		return static_cast<juce::uint32>(state >> 32);
+	}
+
+	RenderWorkerPool& pool;
+};
+
+RenderWorkerPool::RenderWorkerPool(int numWorkers)
+{
+	for (auto workerIndex = 0; workerIndex < numWorkers; ++workerIndex)
+	{
+		auto& worker = workers.emplace_back(std::make_unique<Worker>(*this, workerIndex));
+
+		// without the permission for real-time scheduling the workers still help, just with less reliable timing
+		if (!worker->startRealtimeThread(juce::Thread::RealtimeOptions{}))
+		{
+			worker->startThread(juce::Thread::Priority::highest);
+		}
+	}
+}
+
+RenderWorkerPool::~RenderWorkerPool()
+{
+	// ask all workers to exit first, so that they wind down in parallel
+	for (auto& worker : workers)
+	{
+		worker->signalThreadShouldExit();
+	}
+
+	workers.clear();
+}
+
+int RenderWorkerPool::getNumWorkers() const
+{
+	return static_cast<int>(workers.size());
+}
+
+juce::uint64 RenderWorkerPool::makeBatchState(juce::uint32 batch, int numJobs, int nextJob)
+{
+	return (static_cast<juce::uint64>(batch) << 32)
+		| (static_cast<juce::uint64>(numJobs) << 16)
+		| static_cast<juce::uint64>(nextJob);
+}
+
+bool RenderWorkerPool::claimJob(juce::uint64& state, int& jobIndex)
+{
+	for (;;)
+	{
+		const auto numJobs = static_cast<int>((state >> 16) & MAX_JOBS);
+		const auto nextJob = static_cast<int>(state & MAX_JOBS);
+
+		if (nextJob >= numJobs)
+		{
+			return false;
+		}
+
+		// on failure state is reloaded, which may also mean that a new batch has started in the meantime
+		if (batchState.compare_exchange_weak(state, state + 1))
+		{
+			jobIndex = nextJob;
+			return true;
+		}
+	}
+}
+
+void RenderWorkerPool::runJobs(juce::uint64 state)
+{
+	int jobIndex;
+
+	while (claimJob(state, jobIndex))
+	{
+		/* The job and context are stored before the batch is published and a batch cannot end while one of its jobs
+		 * is claimed but not finished, so they are still those of the batch that the job belongs to.
+		 */
+		currentJob.load()(currentContext.load(), jobIndex);
+		++numFinishedJobs;
+	}
+}
+
+void RenderWorkerPool::run(int numJobs, Job job, void* context)
+{
+	jassert(numJobs <= MAX_JOBS);
+
+	currentJob = job;
+	currentContext = context;
+	numFinishedJobs = 0;
+
+	const auto batch = static_cast<juce::uint32>(batchState.load() >> 32) + 1;
+	const auto state = makeBatchState(batch, numJobs, 0);
+	batchState = state;
+
+	// every job that no worker has claimed by now runs here
+	runJobs(state);
+
+	/* The remaining jobs were claimed by workers which are working on them right now, so this spin takes at most
+	 * one job, unless the scheduler preempts a worker. Sleeping instead would put the audio thread at the mercy of
+	 * the scheduler on every batch.
+	 */
+	while (numFinishedJobs.load() < numJobs)
+	{
+		pause();
+	}
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include "JuceHeader.h"
+#include <memory>
+#include <vector>
+
+/*
+ * A small pool of real-time threads that help the audio thread with a batch of independent jobs. The audio thread
+ * publishes a batch with a single atomic store and then works on the batch itself, so it never waits for a worker
+ * to wake up: every job that no worker has claimed yet is run by the audio thread. It only waits for jobs that a
+ * worker has already started, by spinning until they are done. On the audio thread the pool takes no locks, makes
+ * no system calls that can block and never sleeps.
+ *
+ * Jobs are claimed with a compare-and-swap on one 64-bit word which holds the batch number, the number of jobs and
+ * the next unclaimed job. A worker that wakes up late fails its compare-and-swap as soon as a new batch has been
+ * published and retries on the new word, so it claims a job of the current batch; the job and its context are
+ * stored before a batch is published, so they always belong to the job that was claimed.
+ * Since the audio thread never signals them, the workers watch the batch word themselves: they spin on it for a
+ * moment after every batch, then yield their time slice while batches keep coming, and fall back to polling once
+ * per millisecond when the audio thread has been quiet for a while.
+ */
+class RenderWorkerPool
+{
+public:
+	using Job = void (*)(void* context, int jobIndex);
+
+	// at most MAX_JOBS jobs per batch
+	static constexpr int MAX_JOBS = 0xffff;
+
+	// starts the threads, so this allocates and must not be called on the audio thread
+	explicit RenderWorkerPool(int numWorkers);
+	~RenderWorkerPool();
+
+	int getNumWorkers() const;
+
+	/* Audio thread: calls job(context, i) for every i in [0, numJobs) on the workers and on the calling thread, and
+	 * returns once all jobs have finished. The jobs may run in any order and on any thread.
+	 */
+	void run(int numJobs, Job job, void* context);
+
+private:
+	class Worker;
+
+	/* How many pause instructions a worker spins for on the batch word after a batch, before it starts yielding its
+	 * time slice. That is a few microseconds, so a worker that is done early is still awake for the next batch of the
+	 * same callback.
+	 */
+	static constexpr int MAX_WORKER_SPINS = 2000;
+	// the workers stop yielding and poll once per millisecond when no batch was published for this long
+	static constexpr juce::uint32 YIELD_MILLISECONDS = 20;
+
+	static juce::uint64 makeBatchState(juce::uint32 batch, int numJobs, int nextJob);
+	// claims the next job of the batch in state, returns false if there is none left
+	bool claimJob(juce::uint64& state, int& jobIndex);
+	// runs the jobs that are left in the batch of state
+	void runJobs(juce::uint64 state);
+
+	std::atomic<juce::uint64> batchState{ 0 };
+	std::atomic<int> numFinishedJobs{ 0 };
+	std::atomic<Job> currentJob{ nullptr };
+	std::atomic<void*> currentContext{ nullptr };
+
+	std::vector<std::unique_ptr<Worker>> workers;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RenderWorkerPool)
+};
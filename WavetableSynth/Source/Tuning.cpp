@@ -0,0 +1,304 @@
+#include "Tuning.h"
+
+namespace
+{
+	constexpr auto UNMAPPED = -1;
+
+	// Scala's default mapping puts degree 0 on middle C, which is 261.63 Hz in 12-tone equal temperament
+	constexpr auto DEFAULT_MIDDLE_NOTE = 60;
+	constexpr auto DEFAULT_REFERENCE_FREQUENCY = 261.6255653005986;
+
+	struct KeyboardMapping
+	{
+		int mapSize = 0;
+		int firstNote = 0;
+		int lastNote = Tuning::NUM_NOTES - 1;
+		int middleNote = DEFAULT_MIDDLE_NOTE;
+		int referenceNote = DEFAULT_MIDDLE_NOTE;
+		double referenceFrequency = DEFAULT_REFERENCE_FREQUENCY;
+		// the scale degree that one repetition of the mapping spans, 0 means the period of the scale
+		int octaveDegree = 0;
+		// the scale degree of every key of the pattern, or UNMAPPED
+		std::vector<int> degrees;
+	};
+
+	int floorDivide(int dividend, int divisor)
+	{
+		const auto quotient = dividend / divisor;
+		return quotient * divisor > dividend ? quotient - 1 : quotient;
+	}
+
+	// the first whitespace separated token of a line, Scala ignores everything after it
+	juce::String getFirstToken(const juce::String& line)
+	{
+		return line.trimStart().upToFirstOccurrenceOf(" ", false, false).upToFirstOccurrenceOf("\t", false, false);
+	}
+
+	bool isInteger(const juce::String& token)
+	{
+		const auto digits = token.startsWithChar('-') ? token.substring(1) : token;
+		return digits.isNotEmpty() && digits.containsOnly("0123456789");
+	}
+
+	/* A pitch is given in cents if it contains a period, and as a ratio (e.g. 3/2) or an integer (e.g. 2)
+	 * otherwise. Returns false for anything else.
+	 */
+	bool parsePitch(const juce::String& token, double& cents)
+	{
+		if (token.containsChar('.'))
+		{
+			if (!token.containsOnly("0123456789.-+"))
+			{
+				return false;
+			}
+
+			cents = token.getDoubleValue();
+			return true;
+		}
+
+		const auto numerator = token.upToFirstOccurrenceOf("/", false, false);
+		const auto denominator = token.containsChar('/') ? token.fromFirstOccurrenceOf("/", false, false)
+			: juce::String{ "1" };
+
+		if (numerator.isEmpty() || denominator.isEmpty()
+			|| !numerator.containsOnly("0123456789") || !denominator.containsOnly("0123456789"))
+		{
+			return false;
+		}
+
+		const auto ratio = numerator.getDoubleValue() / denominator.getDoubleValue();
+
+		if (!(ratio > 0.0) || !std::isfinite(ratio))
+		{
+			return false;
+		}
+
+		cents = 1200.0 * std::log2(ratio);
+		return true;
+	}
+
+	/* A .scl file consists of a description line, the number of pitches and one line per pitch, comments start
+	 * with '!'. The pitches are the degrees 1 to n, degree 0 is the implied 1/1 and the last pitch is the period.
+	 */
+	bool parseScale(const juce::String& text, std::vector<double>& degreeCents)
+	{
+		juce::StringArray lines;
+
+		for (const auto& line : juce::StringArray::fromLines(text))
+		{
+			if (!line.startsWithChar('!'))
+			{
+				lines.add(line);
+			}
+		}
+
+		// the description may be empty, but it is always there
+		if (lines.size() < 2)
+		{
+			return false;
+		}
+
+		const auto countToken = getFirstToken(lines[1]);
+
+		if (!isInteger(countToken) || countToken.getIntValue() < 1 || lines.size() < 2 + countToken.getIntValue())
+		{
+			return false;
+		}
+
+		degreeCents.assign(1, 0.0);
+
+		for (auto i = 0; i < countToken.getIntValue(); ++i)
+		{
+			double cents;
+
+			if (!parsePitch(getFirstToken(lines[2 + i]), cents))
+			{
+				return false;
+			}
+
+			degreeCents.push_back(cents);
+		}
+
+		// a period of 0 or less would put every repetition of the scale on the same or a lower pitch
+		return degreeCents.back() > 0.0;
+	}
+
+	/* A .kbm file holds, one per line: the size of the pattern, the first and last key to retune, the key of
+	 * degree 0, the reference key, its frequency, the formal octave degree and then one scale degree (or 'x') per
+	 * key of the pattern. Missing pattern entries are unmapped.
+	 */
+	bool parseKeyboardMapping(const juce::String& text, KeyboardMapping& mapping)
+	{
+		juce::StringArray tokens;
+
+		for (const auto& line : juce::StringArray::fromLines(text))
+		{
+			if (!line.startsWithChar('!') && line.trim().isNotEmpty())
+			{
+				tokens.add(getFirstToken(line));
+			}
+		}
+
+		constexpr auto NUM_HEADER_VALUES = 7;
+
+		if (tokens.size() < NUM_HEADER_VALUES)
+		{
+			return false;
+		}
+
+		for (auto i = 0; i < NUM_HEADER_VALUES; ++i)
+		{
+			// the reference frequency is the only value that is not an integer
+			if (i != 5 && !isInteger(tokens[i]))
+			{
+				return false;
+			}
+		}
+
+		mapping.mapSize = tokens[0].getIntValue();
+		mapping.firstNote = juce::jlimit(0, Tuning::NUM_NOTES - 1, tokens[1].getIntValue());
+		mapping.lastNote = juce::jlimit(0, Tuning::NUM_NOTES - 1, tokens[2].getIntValue());
+		mapping.middleNote = tokens[3].getIntValue();
+		mapping.referenceNote = tokens[4].getIntValue();
+		mapping.referenceFrequency = tokens[5].getDoubleValue();
+		mapping.octaveDegree = tokens[6].getIntValue();
+
+		if (mapping.mapSize < 0 || mapping.octaveDegree < 0 || !(mapping.referenceFrequency > 0.0))
+		{
+			return false;
+		}
+
+		mapping.degrees.assign(static_cast<size_t>(mapping.mapSize), UNMAPPED);
+
+		for (auto i = 0; i < mapping.mapSize && NUM_HEADER_VALUES + i < tokens.size(); ++i)
+		{
+			const auto& token = tokens[NUM_HEADER_VALUES + i];
+
+			if (token.equalsIgnoreCase("x"))
+			{
+				continue;
+			}
+
+			if (!isInteger(token))
+			{
+				return false;
+			}
+
+			mapping.degrees[static_cast<size_t>(i)] = token.getIntValue();
+		}
+
+		return true;
+	}
+
+	// returns false if the key is unmapped
+	bool getScaleDegree(const KeyboardMapping& mapping, int numScaleDegrees, int midiNoteNumber, int& degree)
+	{
+		const auto offset = midiNoteNumber - mapping.middleNote;
+
+		// an empty pattern maps the keys linearly onto the degrees
+		if (mapping.mapSize == 0)
+		{
+			degree = offset;
+			return true;
+		}
+
+		const auto repetition = floorDivide(offset, mapping.mapSize);
+		const auto patternDegree = mapping.degrees[static_cast<size_t>(offset - repetition * mapping.mapSize)];
+
+		if (patternDegree == UNMAPPED)
+		{
+			return false;
+		}
+
+		const auto octaveDegree = mapping.octaveDegree > 0 ? mapping.octaveDegree : numScaleDegrees;
+		degree = patternDegree + repetition * octaveDegree;
+		return true;
+	}
+
+	// degreeCents holds degree 0 to the period, the degrees beyond repeat the scale period by period
+	double getDegreeCents(const std::vector<double>& degreeCents, int degree)
+	{
+		const auto numScaleDegrees = static_cast<int>(degreeCents.size()) - 1;
+		const auto period = floorDivide(degree, numScaleDegrees);
+		return period * degreeCents.back() + degreeCents[static_cast<size_t>(degree - period * numScaleDegrees)];
+	}
+}
+
+Tuning::Tuning(float referenceFrequency)
+{
+	constexpr auto A4_NOTE_NUMBER = 69.f;
+	constexpr auto SEMITONES_IN_AN_OCTAVE = 12.f;
+
+	for (auto midiNoteNumber = 0; midiNoteNumber < NUM_NOTES; ++midiNoteNumber)
+	{
+		// the fundamental frequency shifted relative to the position of A4
+		frequencies[midiNoteNumber] = referenceFrequency
+			* std::pow(2.f, (static_cast<float>(midiNoteNumber) - A4_NOTE_NUMBER) / SEMITONES_IN_AN_OCTAVE);
+	}
+}
+
+bool Tuning::loadScala(const juce::String& scale, const juce::String& keyboardMapping)
+{
+	std::vector<double> degreeCents;
+	KeyboardMapping mapping;
+
+	if (!parseScale(scale, degreeCents)
+		|| (keyboardMapping.isNotEmpty() && !parseKeyboardMapping(keyboardMapping, mapping)))
+	{
+		return false;
+	}
+
+	const auto numScaleDegrees = static_cast<int>(degreeCents.size()) - 1;
+	int referenceDegree;
+
+	// every frequency is relative to the reference key, so that key must be mapped
+	if (!getScaleDegree(mapping, numScaleDegrees, mapping.referenceNote, referenceDegree))
+	{
+		return false;
+	}
+
+	const auto referenceCents = getDegreeCents(degreeCents, referenceDegree);
+	std::array<float, NUM_NOTES> newFrequencies{};
+
+	for (auto midiNoteNumber = mapping.firstNote; midiNoteNumber <= mapping.lastNote; ++midiNoteNumber)
+	{
+		int degree;
+
+		if (!getScaleDegree(mapping, numScaleDegrees, midiNoteNumber, degree))
+		{
+			continue;
+		}
+
+		const auto frequency = mapping.referenceFrequency
+			* std::pow(2.0, (getDegreeCents(degreeCents, degree) - referenceCents) / 1200.0);
+
+		if (!std::isfinite(frequency))
+		{
+			return false;
+		}
+
+		newFrequencies[midiNoteNumber] = static_cast<float>(frequency);
+	}
+
+	frequencies = newFrequencies;
+	return true;
+}
+
+bool Tuning::loadScalaFiles(const juce::File& scaleFile, const juce::File& keyboardMappingFile)
+{
+	if (!scaleFile.existsAsFile()
+		|| (keyboardMappingFile != juce::File{} && !keyboardMappingFile.existsAsFile()))
+	{
+		return false;
+	}
+
+	const auto keyboardMapping = keyboardMappingFile != juce::File{} ? keyboardMappingFile.loadFileAsString()
+		: juce::String{};
+
+	return loadScala(scaleFile.loadFileAsString(), keyboardMapping);
+}
+
+float Tuning::getFrequency(int midiNoteNumber) const
+{
+	return frequencies[midiNoteNumber];
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include "JuceHeader.h"
+
+/*
+ * The frequency of every midi note number, computed once when the tuning is created or loaded, so that a note-on
+ * only reads a table entry instead of calling pow(). The default is 12-tone equal temperament with A4 = 440 Hz.
+ * Other tunings are read from a Scala scale (.scl) and an optional Scala keyboard mapping (.kbm), the formats are
+ * described at https://www.huygens-fokker.org/scala/scl_format.html and help.htm#mappings.
+ * A key that the keyboard mapping leaves unmapped has a frequency of 0 and does not play.
+ */
+class Tuning
+{
+public:
+	static constexpr int NUM_NOTES = 128;
+
+	// 12-tone equal temperament with midi note 69 (A4) at referenceFrequency
+	explicit Tuning(float referenceFrequency = 440.f);
+
+	/* Replaces the tuning with the given scale and keyboard mapping, passed as the text of the files. Without a
+	 * keyboard mapping the scale is laid out linearly over the keys with degree 0 on midi note 60 at 261.63 Hz,
+	 * like Scala does. Returns false and keeps the current tuning if either text cannot be parsed.
+	 */
+	bool loadScala(const juce::String& scale, const juce::String& keyboardMapping = {});
+	// reads the files on the calling thread, so never call this on the audio thread
+	bool loadScalaFiles(const juce::File& scaleFile, const juce::File& keyboardMappingFile = juce::File{});
+
+	float getFrequency(int midiNoteNumber) const;
+
+private:
+	std::array<float, NUM_NOTES> frequencies;
+};
@@ -0,0 +1,273 @@
+#include "Wavetable.h"
+#include "AudioThreadGuard.h"
+
+Wavetable::Wavetable(const std::vector<float>& waveTable, int frameSize)
+	:size{ frameSize > 0 ? frameSize : static_cast<int>(waveTable.size()) },
+	numFrames{ static_cast<int>(waveTable.size()) / size }
+{
+	jassert(size > 0 && numFrames > 0);
+	// samples after the last whole frame are ignored
+	jassert(static_cast<int>(waveTable.size()) == numFrames * size);
+
+	// levels down to a single harmonic: log2(size / 2) + 1 of them
+	numLevels = 1;
+	if (juce::isPowerOfTwo(size))
+	{
+		for (auto harmonics = size / 2; harmonics > 1; harmonics /= 2)
+		{
+			++numLevels;
+		}
+	}
+
+	allocateStorage();
+
+	for (auto frame = 0; frame < numFrames; ++frame)
+	{
+		// level 0 keeps every harmonic, so it is the frame itself without an FFT round trip
+		const auto frameStart = waveTable.begin() + static_cast<std::ptrdiff_t>(frame) * size;
+		auto* frameSamples = getWritableSamples(0, frame);
+		std::copy(frameStart, frameStart + size, frameSamples);
+		writeGuardSamples(frameSamples);
+
+		generateMipLevels(frame);
+	}
+}
+
+Wavetable::Wavetable(const BasicShapes::Levels& levels)
+	:size{ BasicShapes::SIZE },
+	numFrames{ 1 },
+	numLevels{ BasicShapes::NUM_LEVELS }
+{
+	allocateStorage();
+
+	for (auto level = 0; level < numLevels; ++level)
+	{
+		auto* levelSamples = getWritableSamples(level, 0);
+		std::copy(levels[level].begin(), levels[level].end(), levelSamples);
+		writeGuardSamples(levelSamples);
+	}
+}
+
+void Wavetable::allocateStorage()
+{
+	constexpr auto SAMPLES_PER_ALIGNMENT = ALIGNMENT / static_cast<int>(sizeof(float));
+	levelStride = (size + GUARD_SAMPLES + LEADING_GUARD_SAMPLES + SAMPLES_PER_ALIGNMENT - 1)
+		/ SAMPLES_PER_ALIGNMENT * SAMPLES_PER_ALIGNMENT;
+
+	/* HeapBlock does not let us choose the alignment, so we allocate ALIGNMENT - 1 extra bytes and move the start
+	 * of the samples forward to the next 64-byte boundary. The levels of one frame are stored next to each other.
+	 * The first level gets one more ALIGNMENT block in front of it for its leading guard samples.
+	 */
+	const auto numSamples = static_cast<size_t>(levelStride) * static_cast<size_t>(numLevels * numFrames);
+	storage.malloc(numSamples * sizeof(float) + 2 * ALIGNMENT - 1);
+	samples = reinterpret_cast<float*>(juce::snapPointerToAlignment(storage.get(), ALIGNMENT)) + SAMPLES_PER_ALIGNMENT;
+}
+
+/* Level k keeps the harmonics 1 ... (size / 2) >> k of level 0. We transform level 0 once, and for every level
+ * zero the bins above its highest harmonic and transform back. The real-only inverse transform of JUCE rebuilds
+ * the negative frequencies from the non-negative ones, so only bins 0 ... size / 2 need to be edited.
+ */
+void Wavetable::generateMipLevels(int frame)
+{
+	if (numLevels == 1)
+	{
+		return;
+	}
+
+	auto order = 0;
+	while ((1 << order) < size)
+	{
+		++order;
+	}
+
+	juce::dsp::FFT fft{ order };
+	std::vector<float> spectrum(static_cast<size_t>(2 * size), 0.f);
+	std::vector<float> levelSpectrum(spectrum.size());
+
+	const auto* frameSamples = getSamples(0, frame);
+	std::copy(frameSamples, frameSamples + size, spectrum.begin());
+	fft.performRealOnlyForwardTransform(spectrum.data(), true);
+
+	for (auto level = 1; level < numLevels; ++level)
+	{
+		const auto highestHarmonic = (size / 2) >> level;
+
+		levelSpectrum = spectrum;
+		// bins are interleaved (real, imaginary) pairs, bin 0 is the DC offset which we keep
+		std::fill(levelSpectrum.begin() + 2 * (highestHarmonic + 1), levelSpectrum.begin() + size + 2, 0.f);
+		fft.performRealOnlyInverseTransform(levelSpectrum.data());
+
+		auto* levelSamples = getWritableSamples(level, frame);
+		std::copy(levelSpectrum.begin(), levelSpectrum.begin() + size, levelSamples);
+		writeGuardSamples(levelSamples);
+	}
+}
+
+// the table is one period, so the guard samples continue it periodically in both directions
+void Wavetable::writeGuardSamples(float* levelSamples)
+{
+	for (auto i = 1; i <= LEADING_GUARD_SAMPLES; ++i)
+	{
+		levelSamples[-i] = levelSamples[(size - i % size) % size];
+	}
+
+	for (auto i = 0; i < GUARD_SAMPLES; ++i)
+	{
+		levelSamples[size + i] = levelSamples[i % size];
+	}
+}
+
+int Wavetable::getSize() const
+{
+	return size;
+}
+
+int Wavetable::getNumFrames() const
+{
+	return numFrames;
+}
+
+int Wavetable::getNumLevels() const
+{
+	return numLevels;
+}
+
+const float* Wavetable::getSamples(int level, int frame) const
+{
+	return samples + static_cast<size_t>(frame * numLevels + level) * static_cast<size_t>(levelStride);
+}
+
+float* Wavetable::getWritableSamples(int level, int frame)
+{
+	return samples + static_cast<size_t>(frame * numLevels + level) * static_cast<size_t>(levelStride);
+}
+
+int Wavetable::getLevelForIndexIncrement(float indexIncrement) const
+{
+	/* An oscillator that advances by indexIncrement samples per output sample plays the table
+	 * at indexIncrement / size periods per sample. Harmonic h then sits at h * indexIncrement / size, which has to
+	 * stay below 1/2 (Nyquist), i.e. h < size / (2 * indexIncrement).
+	 */
+	const auto allowedHarmonics = static_cast<float>(size) / (2.f * indexIncrement);
+
+	auto level = 0;
+	while (level < numLevels - 1 && static_cast<float>((size / 2) >> level) > allowedHarmonics)
+	{
+		++level;
+	}
+
+	return level;
+}
+
+bool Wavetable::hasSameContent(const std::vector<float>& waveTable, int frameSize) const
+{
+	const auto otherSize = frameSize > 0 ? frameSize : static_cast<int>(waveTable.size());
+
+	if (otherSize != size || static_cast<int>(waveTable.size()) != numFrames * size)
+	{
+		return false;
+	}
+
+	for (auto frame = 0; frame < numFrames; ++frame)
+	{
+		const auto frameStart = waveTable.begin() + static_cast<std::ptrdiff_t>(frame) * size;
+		if (!std::equal(frameStart, frameStart + size, getSamples(0, frame)))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+Wavetable::Ptr WavetableRegistry::getOrCreate(const std::vector<float>& waveTable, int frameSize)
+{
+	// building a table allocates and the registry takes a lock, both are off limits for the audio thread
+	AudioThreadGuard::assertNotOnAudioThread();
+
+	const auto hash = hashContent(waveTable);
+
+	if (auto existingTable = find(hash, waveTable, frameSize))
+	{
+		return existingTable;
+	}
+
+	/* Building the mip levels of a large multi-frame table takes a while, so we do it without holding the lock.
+	 * Should another thread have registered the same content in the meantime, we return its table instead.
+	 */
+	Wavetable::Ptr table{ new Wavetable{ waveTable, frameSize } };
+
+	const juce::ScopedLock scopedLock{ lock };
+
+	if (auto existingTable = find(hash, waveTable, frameSize))
+	{
+		return existingTable;
+	}
+
+	removeUnusedTables();
+	tables.emplace(hash, table);
+	return table;
+}
+
+Wavetable::Ptr WavetableRegistry::getBuiltIn(BasicShapes::Shape shape)
+{
+	AudioThreadGuard::assertNotOnAudioThread();
+
+	const juce::ScopedLock scopedLock{ lock };
+	auto& table = builtInTables[static_cast<size_t>(shape)];
+
+	// only a copy of the embedded samples, cheap enough to be done under the lock
+	if (table == nullptr)
+	{
+		table = new Wavetable{ BasicShapes::getLevels(shape) };
+	}
+
+	return table;
+}
+
+Wavetable::Ptr WavetableRegistry::find(size_t hash, const std::vector<float>& waveTable, int frameSize) const
+{
+	const juce::ScopedLock scopedLock{ lock };
+
+	// a hash match is only a candidate, two different tables may share a hash
+	const auto candidates = tables.equal_range(hash);
+	for (auto candidate = candidates.first; candidate != candidates.second; ++candidate)
+	{
+		if (candidate->second->hasSameContent(waveTable, frameSize))
+		{
+			return candidate->second;
+		}
+	}
+
+	return nullptr;
+}
+
+size_t WavetableRegistry::hashContent(const std::vector<float>& waveTable)
+{
+	// FNV-1a over the raw bytes of the samples
+	auto hash = static_cast<size_t>(14695981039346656037ull);
+	const auto* bytes = reinterpret_cast<const unsigned char*>(waveTable.data());
+
+	for (size_t i = 0; i < waveTable.size() * sizeof(float); ++i)
+	{
+		hash = (hash ^ bytes[i]) * static_cast<size_t>(1099511628211ull);
+	}
+
+	return hash;
+}
+
+void WavetableRegistry::removeUnusedTables()
+{
+	// tables that are only referenced by the registry itself are not used by any oscillator anymore
+	for (auto entry = tables.begin(); entry != tables.end();)
+	{
+		if (entry->second->getReferenceCount() == 1)
+		{
+			entry = tables.erase(entry);
+		}
+		else
+		{
+			++entry;
+		}
+	}
+}
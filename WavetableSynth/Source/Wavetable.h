@@ -0,0 +1,87 @@
+#pragma once
+#include "JuceHeader.h"
+#include "BasicShapes.h"
+#include <map>
+#include <vector>
+
+/*
+ * An immutable, reference-counted wave table. The samples live in a single 64-byte aligned block (one cache line)
+ * surrounded by guard samples: a copy of the last sample right before the first one and copies of the first
+ * samples after the last one. In this way any number of oscillators can point into the same table and interpolate
+ * with up to four points without a modulo. Once constructed a Wavetable never changes, which makes it safe to
+ * share between voices and between plugin instances.
+ * A table whose size is a power of two also gets band-limited mip levels, one per octave: level 0 is the table
+ * itself and level k only keeps the harmonics up to (size / 2) >> k. The harmonics are truncated in the frequency
+ * domain with an FFT. An oscillator picks the level whose highest harmonic stays below Nyquist for the note it
+ * plays, so high notes do not alias and no oversampling is needed.
+ * A table may consist of several frames of equal size (e.g. the 256 frames of 2048 samples of a Serum-style WAV
+ * file). Every frame is a complete period with its own mip levels.
+ * The built-in shapes of BasicShapes come with their mip levels precomputed, so they are copied in as they are.
+ */
+class Wavetable : public juce::ReferenceCountedObject
+{
+public:
+	using Ptr = juce::ReferenceCountedObjectPtr<Wavetable>;
+
+	static constexpr int ALIGNMENT = 64;
+	// the guard samples before getSamples()[0] and after getSamples()[getSize() - 1]
+	static constexpr int LEADING_GUARD_SAMPLES = 1;
+	static constexpr int GUARD_SAMPLES = 2;
+
+	// frameSize 0 means that the whole waveTable is a single frame
+	explicit Wavetable(const std::vector<float>& waveTable, int frameSize = 0);
+	// a single frame whose mip levels were computed at compile time, no FFT is involved
+	explicit Wavetable(const BasicShapes::Levels& levels);
+
+	// number of samples in one period (one frame), the guard sample is not counted
+	int getSize() const;
+	int getNumFrames() const;
+	int getNumLevels() const;
+	/* getSize() + GUARD_SAMPLES samples of the given mip level and frame, aligned to ALIGNMENT bytes. The
+	 * LEADING_GUARD_SAMPLES samples before the returned pointer can be read as well.
+	 */
+	const float* getSamples(int level = 0, int frame = 0) const;
+	// the mip level with the most harmonics that an oscillator advancing by indexIncrement can play without aliasing
+	int getLevelForIndexIncrement(float indexIncrement) const;
+	bool hasSameContent(const std::vector<float>& waveTable, int frameSize) const;
+
+private:
+	void allocateStorage();
+	float* getWritableSamples(int level, int frame);
+	void writeGuardSamples(float* levelSamples);
+	void generateMipLevels(int frame);
+
+	juce::HeapBlock<char> storage;
+	float* samples;
+	int size;
+	int numFrames;
+	int numLevels;
+	/* distance between the starts of two levels, rounded up so that every level starts ALIGNMENT-aligned, the
+	 * leading guard samples of a level are stored at the end of the previous one
+	 */
+	int levelStride;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Wavetable)
+};
+
+/*
+ * The registry hands out shared Wavetable objects keyed by their content: asking twice for a table with the same
+ * samples returns the same object. WavetableSynth reaches it through a juce::SharedResourcePointer, so all plugin
+ * instances loaded in one host process share one copy of every table. The built-in shapes are created on first
+ * use and kept for the lifetime of the registry.
+ */
+class WavetableRegistry
+{
+public:
+	Wavetable::Ptr getOrCreate(const std::vector<float>& waveTable, int frameSize = 0);
+	Wavetable::Ptr getBuiltIn(BasicShapes::Shape shape);
+
+private:
+	static size_t hashContent(const std::vector<float>& waveTable);
+	Wavetable::Ptr find(size_t hash, const std::vector<float>& waveTable, int frameSize) const;
+	void removeUnusedTables();
+
+	juce::CriticalSection lock;
+	std::multimap<size_t, Wavetable::Ptr> tables;
+	std::array<Wavetable::Ptr, BasicShapes::NUM_SHAPES> builtInTables;
+};
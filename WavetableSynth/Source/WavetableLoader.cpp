@@ -0,0 +1,200 @@
+#include "WavetableLoader.h"
+#include "AudioThreadGuard.h"
+
+WavetableLoader::WavetableLoader(WavetableRegistry& registry)
+	:juce::Thread{ "Wavetable Loader" },
+	registry{ registry }
+{
+	startThread(juce::Thread::Priority::background);
+}
+
+WavetableLoader::~WavetableLoader()
+{
+	stopThread(4000);
+
+	// the published table owns a reference which nobody is going to take anymore
+	if (auto* table = publishedTable.exchange(nullptr))
+	{
+		table->decReferenceCount();
+	}
+
+	releaseRetiredTables();
+}
+
+void WavetableLoader::loadWavetable(const juce::File& file, int frameSize)
+{
+	AudioThreadGuard::assertNotOnAudioThread();
+
+	{
+		const juce::ScopedLock scopedLock{ pendingFileLock };
+		pendingFile = file;
+		pendingFrameSize = frameSize;
+	}
+
+	notify();
+}
+
+void WavetableLoader::loadBuiltInWavetable(BasicShapes::Shape shape)
+{
+	AudioThreadGuard::assertNotOnAudioThread();
+
+	{
+		const juce::ScopedLock scopedLock{ pendingFileLock };
+		pendingFile = juce::File{};
+	}
+
+	publish(registry.getBuiltIn(shape));
+}
+
+Wavetable::Ptr WavetableLoader::takePublishedTable()
+{
+	/* The caller is going to retire the table that it replaces, so we only hand out a new table if there is room
+	 * in the FIFO. Otherwise the table stays published and is taken in one of the next blocks.
+	 */
+	if (publishedTable.load() == nullptr || retiredTablesFifo.getFreeSpace() == 0)
+	{
+		return nullptr;
+	}
+
+	auto* table = publishedTable.exchange(nullptr);
+
+	if (table == nullptr)
+	{
+		return nullptr;
+	}
+
+	// the reference owned by the published slot moves into the returned pointer, no count reaches zero here
+	Wavetable::Ptr takenTable{ table };
+	table->decReferenceCountWithoutDeleting();
+	return takenTable;
+}
+
+void WavetableLoader::retireTable(Wavetable::Ptr table)
+{
+	if (table == nullptr)
+	{
+		return;
+	}
+
+	const auto write = retiredTablesFifo.write(1);
+
+	if (write.blockSize1 > 0)
+	{
+		retiredTables[static_cast<size_t>(write.startIndex1)] = std::move(table);
+		return;
+	}
+
+	// takePublishedTable() checks for free space, so the FIFO can only be full if tables are retired from elsewhere
+	jassertfalse;
+}
+
+void WavetableLoader::run()
+{
+	while (!threadShouldExit())
+	{
+		loadPendingFile();
+		releaseRetiredTables();
+
+		// loadWavetable() wakes us up immediately, otherwise we look for retired tables every 100 ms
+		wait(100);
+	}
+}
+
+void WavetableLoader::loadPendingFile()
+{
+	juce::File file;
+	int frameSize;
+
+	{
+		const juce::ScopedLock scopedLock{ pendingFileLock };
+		file = std::exchange(pendingFile, juce::File{});
+		frameSize = pendingFrameSize;
+	}
+
+	if (file == juce::File{})
+	{
+		return;
+	}
+
+	if (auto table = readWavetable(file, frameSize))
+	{
+		publish(std::move(table));
+	}
+	else
+	{
+		DBG("Could not load a wave table from " << file.getFullPathName());
+	}
+}
+
+Wavetable::Ptr WavetableLoader::readWavetable(const juce::File& file, int frameSize)
+{
+	/* A memory-mapped reader lets the operating system page the file in as we read it, instead of copying it
+	 * through an intermediate file buffer. Only the first channel is used and the samples after the last whole
+	 * frame are ignored.
+	 */
+	juce::WavAudioFormat wavFormat;
+	std::unique_ptr<juce::MemoryMappedAudioFormatReader> reader{ wavFormat.createMemoryMappedReader(file) };
+
+	if (reader == nullptr || !reader->mapEntireFile())
+	{
+		return nullptr;
+	}
+
+	// like in Wavetable, a frame size of 0 or less means that the whole file is a single frame
+	if (frameSize <= 0)
+	{
+		frameSize = static_cast<int>(juce::jmin(reader->lengthInSamples,
+			static_cast<juce::int64>(std::numeric_limits<int>::max())));
+	}
+
+	if (frameSize <= 0)
+	{
+		return nullptr;
+	}
+
+	const auto numFrames = static_cast<int>(reader->lengthInSamples / frameSize);
+
+	if (numFrames == 0)
+	{
+		return nullptr;
+	}
+
+	std::vector<float> samples(static_cast<size_t>(numFrames) * static_cast<size_t>(frameSize));
+	auto* destination = samples.data();
+
+	if (!reader->read(&destination, 1, 0, numFrames * frameSize))
+	{
+		return nullptr;
+	}
+
+	// the mip levels of all frames are built here, on the loader thread
+	return registry.getOrCreate(samples, frameSize);
+}
+
+void WavetableLoader::publish(Wavetable::Ptr table)
+{
+	// the published slot owns one reference of its own
+	auto* newTable = table.get();
+	newTable->incReferenceCount();
+
+	// a table that was published but never taken by the audio thread is released right here
+	if (auto* previousTable = publishedTable.exchange(newTable))
+	{
+		previousTable->decReferenceCount();
+	}
+}
+
+void WavetableLoader::releaseRetiredTables()
+{
+	const auto read = retiredTablesFifo.read(retiredTablesFifo.getNumReady());
+
+	for (auto i = 0; i < read.blockSize1; ++i)
+	{
+		retiredTables[static_cast<size_t>(read.startIndex1 + i)] = nullptr;
+	}
+
+	for (auto i = 0; i < read.blockSize2; ++i)
+	{
+		retiredTables[static_cast<size_t>(read.startIndex2 + i)] = nullptr;
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include "JuceHeader.h"
+#include "Wavetable.h"
+
+/*
+ * Loads multi-frame wave tables (e.g. Serum-style WAV files with 256 frames of 2048 samples) on a background
+ * thread and hands them over to the audio thread without locks and without allocations on the audio thread.
+ *
+ * The file is read through a memory-mapped reader and the mip levels of every frame are built on the loader
+ * thread. The finished table is published through an atomic pointer which owns one reference. The audio thread
+ * takes the published table with a single atomic exchange, and gives the table that it replaces back through a
+ * lock-free FIFO. In this way the last reference to a table, and thus its deallocation, is always dropped on the
+ * loader thread, even if the table is tens of MB.
+ */
+class WavetableLoader : private juce::Thread
+{
+public:
+	static constexpr int DEFAULT_FRAME_SIZE = 2048;
+
+	explicit WavetableLoader(WavetableRegistry& registry);
+	~WavetableLoader() override;
+
+	/* Called from any non-audio thread, the file is loaded asynchronously. Like in Wavetable, a frameSize of 0 or
+	 * less loads the whole file as a single frame.
+	 */
+	void loadWavetable(const juce::File& file, int frameSize = DEFAULT_FRAME_SIZE);
+	// called from any non-audio thread, the built-in table is published right away and replaces a pending file
+	void loadBuiltInWavetable(BasicShapes::Shape shape);
+
+	// audio thread: returns the most recently loaded table once, or nullptr if there is nothing new
+	Wavetable::Ptr takePublishedTable();
+	// audio thread: hands a table that is no longer used back to the loader thread to be released there
+	void retireTable(Wavetable::Ptr table);
+
+private:
+	static constexpr int RETIRED_TABLES_CAPACITY = 8;
+
+	void run() override;
+	void loadPendingFile();
+	Wavetable::Ptr readWavetable(const juce::File& file, int frameSize);
+	void publish(Wavetable::Ptr table);
+	void releaseRetiredTables();
+
+	WavetableRegistry& registry;
+
+	juce::CriticalSection pendingFileLock;
+	juce::File pendingFile;
+	int pendingFrameSize = DEFAULT_FRAME_SIZE;
+
+	std::atomic<Wavetable*> publishedTable{ nullptr };
+
+	juce::AbstractFifo retiredTablesFifo{ RETIRED_TABLES_CAPACITY };
+	std::array<Wavetable::Ptr, RETIRED_TABLES_CAPACITY> retiredTables;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(WavetableLoader)
+};
@@ -1,10 +1,17 @@
 #include "WavetableOscillator.h"
+#include "JuceHeader.h"
 #include <cmath>
-WavetableOscillator::WavetableOscillator(std::vector<float> waveTable, double sampleRate)
+WavetableOscillator::WavetableOscillator(Wavetable::Ptr waveTable, double sampleRate)
 	:waveTable{ std::move(waveTable) },
+	table{ this->waveTable->getSamples() },
+	tableSize{ this->waveTable->getSize() },
 	sampleRate{ sampleRate }
 {
-
+	/* The oscillator only points into the table, it does not copy it. The table is surrounded by guard samples,
+	 * i.e. copies of its last sample before the first one and of its first samples after the last one. In this
+	 * way the interpolation can always read table[truncatedIndex - 1] ... table[truncatedIndex + 2] and never
+	 * needs the modulo to wrap around the ends of the table.
+	 */
 }
 
 /* We need 2 functions here.
@@ -12,40 +19,164 @@ WavetableOscillator::WavetableOscillator(std::vector<float> waveTable, double sa
  * 2nd one that loops over the waveTable. This is the core of the Wavetable Synthesis algorithm.
  */
 
- // Here we calculate the indexIncrement. 
+ // Here we calculate the indexIncrement.
 void WavetableOscillator::setFrequency(float frequency)
 {
-	indexIncrement = frequency * static_cast<float>(waveTable.size()) / static_cast <float>(sampleRate);
+	indexIncrement = frequency * static_cast<float>(tableSize) / static_cast <float>(sampleRate);
+	// the higher the note, the fewer harmonics of the table fit below Nyquist, so we switch to a band-limited level
+	table = waveTable->getSamples(waveTable->getLevelForIndexIncrement(indexIncrement));
 }
 
 
+void WavetableOscillator::setInterpolation(Interpolation::Type type)
+{
+	interpolation = type;
+}
+
 float WavetableOscillator::getSample()
 {
-	// We need to retrieve the sample using linear interpolation
-	const auto sample = interpolateLinearly();
+	auto sample = 0.f;
+
+	// We need to retrieve the sample using the interpolation policy, linear by default
+	Interpolation::withPolicy(interpolation, [&](auto policy)
+	{
+		sample = interpolate<decltype(policy)>();
+	});
 	// We need it to be a member function to have access to the waveTable index and waveTable size which are
-	// necessary for the linear interpolation.
+	// necessary for the interpolation.
 	index += indexIncrement;
 	// fmod to take our index and bring it back to the wave table size range
-	index = std::fmod(index, static_cast<float>(waveTable.size()));
+	index = std::fmod(index, static_cast<float>(tableSize));
 	return sample;
 }
 
-float WavetableOscillator::interpolateLinearly()
+namespace
+{
+	constexpr auto CHUNK_SIZE = 64;
+
+	/* The table values around the index of every sample of a chunk, the arrays must be aligned for SIMD access.
+	 * Policies with fewer points leave the outer arrays alone.
+	 */
+	struct Chunk
+	{
+		alignas(64) float previousSamples[CHUNK_SIZE];
+		alignas(64) float currentSamples[CHUNK_SIZE];
+		alignas(64) float nextSamples[CHUNK_SIZE];
+		alignas(64) float afterNextSamples[CHUNK_SIZE];
+		alignas(64) float nextIndexWeights[CHUNK_SIZE];
+	};
+
+	template <typename Policy>
+	void gather(Chunk& chunk, int i, const float* table, int truncatedIndex)
+	{
+		chunk.currentSamples[i] = table[truncatedIndex];
+
+		if constexpr (Policy::NUM_POINTS >= 2)
+		{
+			chunk.nextSamples[i] = table[truncatedIndex + 1];
+		}
+
+		if constexpr (Policy::NUM_POINTS >= 4)
+		{
+			chunk.previousSamples[i] = table[truncatedIndex - 1];
+			chunk.afterNextSamples[i] = table[truncatedIndex + 2];
+		}
+	}
+
+	/* Interpolates a whole chunk: currentSamples[i] becomes the policy's combination of the table values around
+	 * sample i. The points that the policy does not use are pointed at currentSamples, which is always gathered.
+	 */
+	template <typename Policy>
+	void interpolateChunk(Chunk& chunk, int chunkLength)
+	{
+		auto* const current = chunk.currentSamples;
+		const auto* const previous = Policy::NUM_POINTS >= 4 ? chunk.previousSamples : current;
+		const auto* const next = Policy::NUM_POINTS >= 2 ? chunk.nextSamples : current;
+		const auto* const afterNext = Policy::NUM_POINTS >= 4 ? chunk.afterNextSamples : current;
+		const auto* const nextIndexWeights = Policy::NUM_POINTS >= 2 ? chunk.nextIndexWeights : current;
+
+		auto i = 0;
+#if JUCE_USE_SIMD
+		using Vector = juce::dsp::SIMDRegister<float>;
+		constexpr auto VECTOR_SIZE = static_cast<int>(Vector::SIMDNumElements);
+
+		for (; i + VECTOR_SIZE <= chunkLength; i += VECTOR_SIZE)
+		{
+			const auto sample = Policy::interpolate(Vector::fromRawArray(previous + i),
+				Vector::fromRawArray(current + i), Vector::fromRawArray(next + i),
+				Vector::fromRawArray(afterNext + i), Vector::fromRawArray(nextIndexWeights + i));
+			sample.copyToRawArray(current + i);
+		}
+#endif
+		// scalar fallback for the chunk tail (and for builds without SIMD support)
+		for (; i < chunkLength; ++i)
+		{
+			current[i] = Policy::interpolate(previous[i], current[i], next[i], afterNext[i], nextIndexWeights[i]);
+		}
+	}
+}
+
+/* render() produces exactly the same samples as calling getSample() numSamples times, but splits the work in
+ * three passes over small chunks so that the arithmetic can run on SIMD registers:
+ * 1. a scalar pass walks the index and gathers the neighbouring table values and the interpolation weight,
+ * 2. a vectorized pass computes the interpolation SIMDNumElements samples at a time,
+ * 3. the chunk is added onto the output with FloatVectorOperations (which is SIMD-optimized as well).
+ * Instead of std::fmod we subtract the table size when the index runs past the end. For an index in
+ * [tableSize, 2 * tableSize) this subtraction is exact, so the index follows the same values as in getSample().
+ * The interpolation policy is picked here, once per call, and the passes are compiled for each policy.
+ */
+void WavetableOscillator::render(float* output, int numSamples)
+{
+	Interpolation::withPolicy(interpolation, [&](auto policy)
+	{
+		renderFloatingPoint<decltype(policy)>(output, numSamples);
+	});
+}
+
+template <typename Policy>
+void WavetableOscillator::renderFloatingPoint(float* output, int numSamples)
+{
+	Chunk chunk;
+	const auto size = static_cast<float>(tableSize);
+
+	for (auto chunkStart = 0; chunkStart < numSamples; chunkStart += CHUNK_SIZE)
+	{
+		const auto chunkLength = std::min(CHUNK_SIZE, numSamples - chunkStart);
+
+		for (auto i = 0; i < chunkLength; ++i)
+		{
+			const auto truncatedIndex = static_cast<int>(index);
+			gather<Policy>(chunk, i, table, truncatedIndex);
+			chunk.nextIndexWeights[i] = index - static_cast<float>(truncatedIndex);
+
+			index += indexIncrement;
+			while (index >= size)
+			{
+				index -= size;
+			}
+		}
+
+		interpolateChunk<Policy>(chunk, chunkLength);
+		juce::FloatVectorOperations::add(output + chunkStart, chunk.currentSamples, chunkLength);
+	}
+}
+
+template <typename Policy>
+float WavetableOscillator::interpolate() const
 {
-	/* if we have an index between two integer indices then we return the weighted sum of the
-	 * waveTable values that correspond to these nearest integer indices.
-	 * The weights that we take between those 2 values are the distances from the index to the next integer
-	 * index. We may weight the sample that the index is nearer to with a larger weight. To truncate the index we just
-	 * use the static cast to the integer because it needs to be a floating point number. The range is (0,1) and then is
-	 * normalized to the range from defined by waveTable size.
+	/* if we have an index between two integer indices then we combine the waveTable values around it. For the
+	 * linear policy this is the weighted sum of the two nearest values, where the weights are the distances from
+	 * the index to the next integer index, so the sample that the index is nearer to gets the larger weight. To
+	 * truncate the index we just use the static cast to the integer because it needs to be a floating point
+	 * number. The cubic policies also read the value before and the one after the next.
+	 * Thanks to the guard samples, truncatedIndex - 1 and truncatedIndex + 2 are always valid positions, even at
+	 * either end of the table.
 	 */
 	const auto truncatedIndex = static_cast<int>(index);
-	const auto nextIndex = (truncatedIndex + 1) % static_cast<int>(waveTable.size());
 	const auto nextIndexWeight = index - static_cast<float>(truncatedIndex);
-	const auto truncatedIndexWeight = 1.f - nextIndexWeight;
 
-	return truncatedIndexWeight * waveTable[truncatedIndex] + nextIndexWeight * waveTable[nextIndex];
+	return Policy::interpolate(table[truncatedIndex - 1], table[truncatedIndex], table[truncatedIndex + 1],
+		table[truncatedIndex + 2], nextIndexWeight);
 }
 
 void WavetableOscillator::stop()
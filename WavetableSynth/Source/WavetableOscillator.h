@@ -1,23 +1,39 @@
 #pragma once
-#include <vector>
+#include "Wavetable.h"
+#include "Interpolation.h"
 
 /*
- * This class holds a waveTable and a samplingRate for the looping of the WaveTable
+ * This class holds a waveTable and a samplingRate for the looping of the WaveTable.
+ * The plugin renders its voices with WavetableVoiceBank, whose lanes keep a fixed-point phase. The oscillator is
+ * the per-voice reference model with a float index, which the Benchmarks compare the voice bank against.
  */
 class WavetableOscillator
 {
 public:
 	// constructor of WavetableOscillator
-	WavetableOscillator(std::vector<float> waveTable, double sampleRate);
+	WavetableOscillator(Wavetable::Ptr waveTable, double sampleRate);
+	// linear by default, the policy is picked once per render() call and not per sample
+	void setInterpolation(Interpolation::Type type);
 	void setFrequency(float frequency);
 	float getSample();
+	// adds numSamples samples of this oscillator onto output (block version of getSample())
+	void render(float* output, int numSamples);
 	void stop();
 	bool isPlaying();
 private:
-	float interpolateLinearly();
-	std::vector<float> waveTable;
+	template <typename Policy>
+	float interpolate() const;
+	template <typename Policy>
+	void renderFloatingPoint(float* output, int numSamples);
+	// shared, immutable table: one period surrounded by guard samples that continue it in both directions
+	Wavetable::Ptr waveTable;
+	// the band-limited mip level of waveTable that suits the current frequency
+	const float* table;
+	int tableSize;
 	double sampleRate;
 	float index = 0.f;
 	float indexIncrement = 0.f;
 
+	Interpolation::Type interpolation = Interpolation::Type::linear;
+
 };
\ No newline at end of file
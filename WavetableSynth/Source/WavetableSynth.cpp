@@ -1,41 +1,40 @@
 #include "WavetableSynth.h"
+#include "AudioThreadGuard.h"
 
-std::vector<float> WavetableSynth::generateSineWaveTable()
+void WavetableSynth::initializeOscillators()
 {
-	// Fix length of wave table to a certain amount of samples (ex: 64)
-	constexpr auto WAVETABLE_LENGTH = 64;
-	std::vector<float> sineWaveTable(WAVETABLE_LENGTH);
-
-	/* Now we need to loop over the wavetable length and assign each point a value of a sine function and
-	 * we want to have just one period of the sine stored.
+	/* We want to have a polyphonic waveTable synthesizer so that we can play multiple keys at once. The voices
+	 * live in a WavetableVoiceBank, a preallocated pool of 128 voices which keeps their state in contiguous arrays
+	 * so that several voices are advanced per SIMD instruction. Up to the polyphony of them play at once and any
+	 * key can take any voice. To initialize them we need to pass them the waveTable. The sine and its mip levels
+	 * were computed by the compiler (see BasicShapes), so there is no math to do here. The table itself is shared:
+	 * the registry returns the same Wavetable object every time, so all voices and all plugin instances point into
+	 * a single copy.
 	 */
-	const auto PI = std::atanf(1.f) * 4;
+	static_assert(WavetableVoiceBank::MAX_VOICES == 128, "every midi note number can hold a voice");
 
-	for (auto i = 0; i < WAVETABLE_LENGTH; ++i)
+	/* Hosts may call prepareToPlay() again on every transport start or offline bounce, so only the first call
+	 * builds anything. The sine is only the initial table, a table that was loaded from a file is kept.
+	 */
+	if (!voices.hasWaveTable())
 	{
-		sineWaveTable[i] = std::sinf(2 * PI * static_cast<float>(i) / static_cast<float>(WAVETABLE_LENGTH));
+		voices.exchangeWaveTable(wavetableRegistry->getBuiltIn(BasicShapes::Shape::sine));
 	}
 
-	return sineWaveTable;
-}
-
-void WavetableSynth::initializeOscillators()
-{
-	/* 128 oscillators initialization because we want to have a polyphonic waveTable synthesizer so that
-	 * we can play multiple keys at once, so each oscillator will be assigned to its own unique key.
-	 * To initialize them we need to pass them the waveTable thus the waveTable must be generated.
+	/* Later calls reuse the voice bank as it is. If the sampling rate changed, the playing voices are retuned to
+	 * it instead of being cut off, so notes that are still ringing keep their pitch.
 	 */
-	constexpr auto OSCILLATORS_COUNT = 128; //the number of midi note numbers that we have available
+	voices.setSampleRate(sampleRate);
 
-	const auto waveTable = generateSineWaveTable();
-	/* When we initialize our oscillators we need to clear them first because if we change the sampling rate during
-	 * processing it may happen that we already had some oscillators. The placed back takes the arguments of the
-	 * constructor of the oscillator.
-	 */
-	oscillators.clear();
-	for (auto i = 0; i < OSCILLATORS_COUNT; ++i)
+	// starting and stopping threads allocates, so the worker pool is only changed here and never while processing
+	const auto numWorkers = numRenderWorkers.load();
+	const auto currentNumWorkers = renderWorkerPool != nullptr ? renderWorkerPool->getNumWorkers() : 0;
+
+	if (numWorkers != currentNumWorkers)
 	{
-		oscillators.emplace_back(waveTable, sampleRate);
+		voices.setRenderWorkerPool(nullptr);
+		renderWorkerPool.reset(numWorkers > 0 ? new RenderWorkerPool{ numWorkers } : nullptr);
+		voices.setRenderWorkerPool(renderWorkerPool.get());
 	}
 }
 
@@ -49,6 +48,143 @@ void WavetableSynth::prepareToPlay(double sampleRate)
 	initializeOscillators();
 }
 
+void WavetableSynth::loadWavetable(const juce::File& file, int frameSize)
+{
+	tableLoader.loadWavetable(file, frameSize);
+}
+
+void WavetableSynth::loadBuiltInWavetable(BasicShapes::Shape shape)
+{
+	tableLoader.loadBuiltInWavetable(shape);
+}
+
+void WavetableSynth::setPolyphony(int numVoices)
+{
+	polyphony = numVoices;
+}
+
+double WavetableSynth::getTailLengthSeconds() const
+{
+	return releaseSeconds.load();
+}
+
+void WavetableSynth::setEnvelope(const WavetableVoiceBank::Envelope& envelope)
+{
+	attackSeconds = envelope.attackSeconds;
+	decaySeconds = envelope.decaySeconds;
+	sustainLevel = envelope.sustainLevel;
+	releaseSeconds = envelope.releaseSeconds;
+	envelopeChanged = true;
+}
+
+void WavetableSynth::setUnison(const WavetableVoiceBank::Unison& unison)
+{
+	numUnisonVoices = unison.numVoices;
+	unisonDetuneCents = unison.detuneCents;
+	unisonStereoSpread = unison.stereoSpread;
+	unisonChanged = true;
+}
+
+void WavetableSynth::setStereo(const WavetableVoiceBank::Stereo& stereo)
+{
+	stereoPan = stereo.pan;
+	stereoSpread = stereo.spread;
+	stereoChanged = true;
+}
+
+void WavetableSynth::setVibrato(const WavetableVoiceBank::Vibrato& vibrato)
+{
+	vibratoRateHz = vibrato.rateHz;
+	vibratoDepthCents = vibrato.depthCents;
+	vibratoChanged = true;
+}
+
+void WavetableSynth::setFilter(const WavetableVoiceBank::Filter& filter)
+{
+	filterMode = filter.mode;
+	filterCutoffHz = filter.cutoffHz;
+	filterResonance = filter.resonance;
+	filterKeyTracking = filter.keyTracking;
+	filterEnvelopeOctaves = filter.envelopeOctaves;
+	filterChanged = true;
+}
+
+void WavetableSynth::setExpression(const WavetableVoiceBank::Expression& expression)
+{
+	pressureDepth = expression.pressureDepth;
+	timbreOctaves = expression.timbreOctaves;
+	expressionChanged = true;
+}
+
+void WavetableSynth::setModulation(WavetableVoiceBank::ModulationSource source,
+	WavetableVoiceBank::ModulationDestination destination, float amount)
+{
+	modulationAmounts[static_cast<size_t>(source) * WavetableVoiceBank::NUM_MODULATION_DESTINATIONS
+		+ static_cast<size_t>(destination)] = amount;
+	modulationChanged = true;
+}
+
+void WavetableSynth::setLfo(int lfoIndex, const WavetableVoiceBank::Lfo& lfo)
+{
+	jassert(lfoIndex >= 0 && lfoIndex < WavetableVoiceBank::NUM_LFOS);
+	lfoShapes[static_cast<size_t>(lfoIndex)] = lfo.shape;
+	lfoRatesHz[static_cast<size_t>(lfoIndex)] = lfo.rateHz;
+	lfosChanged = true;
+}
+
+void WavetableSynth::setMpeZoneLayout(const juce::MPEZoneLayout& layout)
+{
+	AudioThreadGuard::assertNotOnAudioThread();
+
+	{
+		const juce::SpinLock::ScopedLockType scopedLock{ pendingZoneLayoutLock };
+		pendingZoneLayout = layout;
+	}
+
+	zoneLayoutChanged = true;
+}
+
+void WavetableSynth::setInterpolation(Interpolation::Type type)
+{
+	interpolation = type;
+}
+
+void WavetableSynth::setPitchBendRange(float semitones)
+{
+	pitchBendRangeSemitones = semitones;
+}
+
+void WavetableSynth::setTuning(const Tuning& tuning)
+{
+	AudioThreadGuard::assertNotOnAudioThread();
+
+	{
+		const juce::SpinLock::ScopedLockType scopedLock{ pendingTuningLock };
+		pendingTuning = tuning;
+	}
+
+	tuningChanged = true;
+}
+
+bool WavetableSynth::loadTuning(const juce::File& scaleFile, const juce::File& keyboardMappingFile)
+{
+	Tuning newTuning;
+
+	if (!newTuning.loadScalaFiles(scaleFile, keyboardMappingFile))
+	{
+		DBG("Could not load a tuning from " << scaleFile.getFullPathName());
+		return false;
+	}
+
+	setTuning(newTuning);
+	return true;
+}
+
+void WavetableSynth::setNumRenderWorkers(int numWorkers)
+{
+	numRenderWorkers = numWorkers;
+}
+
 /* We have our block of samples and at some points midi messages may have happened. We want to read out these
  * midi messages and render the sound in between these midi messages, because in between no synthesizer parameters
  * were changed. So the environment stays constant and our sound can get generated. We're doing here this
@@ -56,6 +192,106 @@ void WavetableSynth::prepareToPlay(double sampleRate)
  */
 void WavetableSynth::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
+	/* An idle engine returns right away: no voice is sounding and no event can start one. Pending changes of the
+	 * table or the parameters wait for the first block that plays something, since they cannot be heard before.
+	 * The buffer is not touched, so a buffer that the caller cleared keeps its hasBeenCleared() flag, which tells
+	 * the plugin wrapper that the output is silent.
+	 */
+	if (voices.isSilent() && midiMessages.isEmpty())
+	{
+		return;
+	}
+
+	/* A table that finished loading in the background is picked up at the start of the block. Taking it is a single
+	 * atomic exchange and the table it replaces goes back to the loader thread, so this never blocks or allocates.
+	 */
+	if (auto loadedTable = tableLoader.takePublishedTable())
+	{
+		tableLoader.retireTable(voices.exchangeWaveTable(std::move(loadedTable)));
+	}
+
+	voices.setPolyphony(polyphony);
+	voices.setInterpolation(interpolation);
+
+	if (envelopeChanged.exchange(false))
+	{
+		voices.setEnvelope({ attackSeconds, decaySeconds, sustainLevel, releaseSeconds });
+	}
+
+	if (unisonChanged.exchange(false))
+	{
+		voices.setUnison({ numUnisonVoices, unisonDetuneCents, unisonStereoSpread });
+	}
+
+	if (stereoChanged.exchange(false))
+	{
+		voices.setStereo({ stereoPan, stereoSpread });
+	}
+
+	if (vibratoChanged.exchange(false))
+	{
+		voices.setVibrato({ vibratoRateHz, vibratoDepthCents });
+	}
+
+	if (filterChanged.exchange(false))
+	{
+		voices.setFilter({ filterMode, filterCutoffHz, filterResonance, filterKeyTracking, filterEnvelopeOctaves });
+	}
+
+	if (expressionChanged.exchange(false))
+	{
+		voices.setExpression({ pressureDepth, timbreOctaves });
+	}
+
+	if (modulationChanged.exchange(false))
+	{
+		for (auto source = 0; source < WavetableVoiceBank::NUM_MODULATION_SOURCES; ++source)
+		{
+			for (auto destination = 0; destination < WavetableVoiceBank::NUM_MODULATION_DESTINATIONS; ++destination)
+			{
+				voices.setModulation(static_cast<WavetableVoiceBank::ModulationSource>(source),
+					static_cast<WavetableVoiceBank::ModulationDestination>(destination),
+					modulationAmounts[static_cast<size_t>(source * WavetableVoiceBank::NUM_MODULATION_DESTINATIONS
+						+ destination)]);
+			}
+		}
+	}
+
+	if (lfosChanged.exchange(false))
+	{
+		for (auto lfoIndex = 0; lfoIndex < WavetableVoiceBank::NUM_LFOS; ++lfoIndex)
+		{
+			const auto lfo = static_cast<size_t>(lfoIndex);
+			voices.setLfo(lfoIndex, { lfoShapes[lfo], lfoRatesHz[lfo] });
+		}
+	}
+
+	/* The audio thread never waits for the lock: if setTuning() holds it right now, the new tuning is copied in one
+	 * of the next blocks.
+	 */
+	if (tuningChanged.load())
+	{
+		const juce::SpinLock::ScopedTryLockType scopedTryLock{ pendingTuningLock };
+
+		if (scopedTryLock.isLocked())
+		{
+			tuningChanged = false;
+			tuning = pendingTuning;
+		}
+	}
+
+	if (zoneLayoutChanged.load())
+	{
+		const juce::SpinLock::ScopedTryLockType scopedTryLock{ pendingZoneLayoutLock };
+
+		if (scopedTryLock.isLocked())
+		{
+			zoneLayoutChanged = false;
+			zoneLayout = pendingZoneLayout;
+			voices.resetChannelExpressions();
+		}
+	}
+
 	// start of processBlock
 	auto currentSample = 0;
 	// iterate over the midi buffer
@@ -64,6 +300,14 @@ void WavetableSynth::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBu
 	 */
 	for (const auto midiMessage : midiMessages)
 	{
+		/* A MidiMessage stores short messages in place, but copies longer ones (sysex) to the heap. We don't use
+		 * them anyway, so we skip them before they can allocate on the audio thread.
+		 */
+		if (midiMessage.numBytes > 3)
+		{
+			continue;
+		}
+
 		const auto midiEvent = midiMessage.getMessage();
 		// we need to know when the midi event happens and for this we need again an index of the respective sample
 		const auto midiEventSample = static_cast<int>(midiEvent.getTimeStamp());
@@ -81,67 +325,128 @@ void WavetableSynth::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBu
 
 void WavetableSynth::render(juce::AudioBuffer<float>& buffer, int startSample, int endSample)
 {
-	auto* firstChannel = buffer.getWritePointer(0);
-
-	for (auto& oscillator : oscillators)
+	// e.g. the samples before the first note-on of a block, getWritePointer() would reset hasBeenCleared()
+	if (voices.isSilent())
 	{
-		if (oscillator.isPlaying())
-		{
-			for (auto sample = startSample; sample < endSample; ++sample)
-			{
-				firstChannel[sample] += oscillator.getSample();
-			}
-		}
+		return;
 	}
 
-	for (auto channel = 1; channel < buffer.getNumChannels(); ++channel)
-	{
-		std::copy(firstChannel + startSample, firstChannel + endSample,
-			buffer.getWritePointer(channel)
-			+ startSample);
-	}
+	auto* left = buffer.getWritePointer(0) + startSample;
+	auto* right = buffer.getNumChannels() > 1 ? buffer.getWritePointer(1) + startSample : nullptr;
+
+	/* One pass over the playing voices of the voice bank instead of walking every oscillator object. Every voice
+	 * is panned into the first two channels in that same pass, or mixed down if there is only one. The synth is a
+	 * stereo source, so on a bus with more channels the others stay silent instead of getting copies.
+	 */
+	voices.render(left, right, endSample - startSample);
 }
 
 /* midiEvent gives us information on whether a key was released or there was some other type of control information.
  * We will only handle very basic type of midi note ON event and midi note OFF event. To handle these events what we need
  * is several oscillators, which are quite low-level. Usually we have voices and each voice may consist out of many
- * oscillators. Here for simplicity we have as many oscillators as the keys of a piano keyboard and each of these
- * oscillators will be capable of playing exactly that key.
+ * oscillators. Here a voice is a single oscillator with an envelope, taken from the voice bank when a key is pressed.
+ * Releasing the key starts the release of the envelope, and the voice returns to the bank once it is silent.
+ * Without MPE the synth is omni: a note is the same note on every channel and the pitch wheel of any channel bends
+ * all of them. With MPE a note is keyed by its channel as well, and the pitch bend, channel pressure and CC 74
+ * (timbre) of a member channel belong to the notes of that channel. Such an event only stores its value in the
+ * voice bank, which applies it at the next control block. The master channel of a zone bends the notes of that
+ * zone only, by its own master pitch bend range.
  */
 void WavetableSynth::handleMidiEvent(const juce::MidiMessage& midiEvent)
 {
+	// MPE configuration messages (RPN 6 on a master channel) set up or remove the zones
+	zoneLayout.processNextMidiEvent(midiEvent);
+
+	const auto lowerZone = zoneLayout.getLowerZone();
+	const auto upperZone = zoneLayout.getUpperZone();
+	const auto isMpe = lowerZone.isActive() || upperZone.isActive();
+	const auto channel = midiEvent.getChannel();
+	const auto voiceChannel = isMpe ? channel : 1;
+	const auto* memberZone = lowerZone.isUsingChannelAsMemberChannel(channel) ? &lowerZone
+		: upperZone.isUsingChannelAsMemberChannel(channel) ? &upperZone : nullptr;
+	const auto* masterZone = lowerZone.isActive() && lowerZone.getMasterChannel() == channel ? &lowerZone
+		: upperZone.isActive() && upperZone.getMasterChannel() == channel ? &upperZone : nullptr;
+
 	if (midiEvent.isNoteOn())
 	{
 		//midi note number
 		const auto oscillatorId = midiEvent.getNoteNumber();
 		// retrieve frequency that we want to set to our oscillator
 		const auto frequency = midiNoteNumberToFrequency(oscillatorId);
-		// pick an oscillator from our oscillator set that we'll initialize with the computed frequency
-		oscillators[oscillatorId].setFrequency(frequency);
+
+		// a key that the tuning leaves unmapped does not play
+		if (frequency > 0.f)
+		{
+			// pick an oscillator from our oscillator set that we'll initialize with the computed frequency
+			voices.startVoice(oscillatorId, frequency, voiceChannel, midiEvent.getFloatVelocity());
+		}
 	}
 	else if (midiEvent.isNoteOff())
 	{
 		const auto oscillatorId = midiEvent.getNoteNumber();
-		oscillators[oscillatorId].stop();
+		voices.stopVoice(oscillatorId, voiceChannel);
 	}
-	else if (midiEvent.isAllNotesOff())
+	else if (midiEvent.isPitchWheel())
 	{
-		for (auto& oscillator : oscillators)
+		constexpr auto PITCH_WHEEL_CENTRE = 8192.f;
+		const auto deflection = (static_cast<float>(midiEvent.getPitchWheelValue()) - PITCH_WHEEL_CENTRE)
+			/ PITCH_WHEEL_CENTRE;
+
+		if (memberZone != nullptr)
 		{
-			oscillator.stop();
+			voices.setChannelPitchBend(channel, deflection * static_cast<float>(memberZone->perNotePitchbendRange));
+		}
+		else if (masterZone != nullptr)
+		{
+			// the member channels of the upper zone count down from 15
+			const auto firstMemberChannel = std::min(masterZone->getFirstMemberChannel(),
+				masterZone->getLastMemberChannel());
+			const auto lastMemberChannel = std::max(masterZone->getFirstMemberChannel(),
+				masterZone->getLastMemberChannel());
+			voices.setZonePitchBend(firstMemberChannel, lastMemberChannel,
+				deflection * static_cast<float>(masterZone->masterPitchbendRange));
+		}
+		else
+		{
+			/* The bend is one ratio for all voices, which the voice bank multiplies into their index increments
+			 * while rendering. So a wheel movement costs one exp2() here, not one per voice or per sample.
+			 */
+			voices.setPitchBendRatio(std::exp2(deflection * pitchBendRangeSemitones / 12.f));
 		}
-
+	}
+	else if (midiEvent.isChannelPressure())
+	{
+		if (memberZone != nullptr)
+		{
+			voices.setChannelPressure(channel, static_cast<float>(midiEvent.getChannelPressureValue()) / 127.f);
+		}
+	}
+	else if (midiEvent.isControllerOfType(MPE_TIMBRE_CONTROLLER))
+	{
+		if (memberZone != nullptr)
+		{
+			voices.setChannelTimbre(channel, static_cast<float>(midiEvent.getControllerValue()) / 127.f);
+		}
+	}
+	else if (midiEvent.isControllerOfType(MOD_WHEEL_CONTROLLER))
+	{
+		voices.setModWheel(static_cast<float>(midiEvent.getControllerValue()) / 127.f);
+	}
+	else if (midiEvent.isAllNotesOff())
+	{
+		voices.releaseAllVoices();
+	}
+	else if (midiEvent.isAllSoundOff())
+	{
+		voices.stopAllVoices();
 	}
 
 }
 
 float WavetableSynth::midiNoteNumberToFrequency(int midiNoteNumber)
 {
-	// We want to tune our instrument to be 440Hz at A4
-	constexpr auto A4_FREQUENCY = 440.f;
-	constexpr auto A4_NOTE_NUMBER = 69.f;
-	constexpr auto SEMITONES_IN_AN_OCATAVE = 12.f;
-
-	// return the fundamental frequency shifted relative to its position
-	return A4_FREQUENCY * std::powf(2.f, (midiNoteNumber - A4_NOTE_NUMBER) / SEMITONES_IN_AN_OCATAVE);
+	/* The tuning computed the frequency of every note when it was created (by default 440Hz at A4 in equal
+	 * temperament), so a note-on only reads the table.
+	 */
+	return tuning.getFrequency(midiNoteNumber);
 }
\ No newline at end of file
@@ -1,20 +1,122 @@
 #pragma once
 #include "JuceHeader.h"
-#include "WavetableOscillator.h"
+#include "WavetableVoiceBank.h"
+#include "WavetableLoader.h"
+#include "Tuning.h"
 
 class WavetableSynth
 {
 public:
 	void prepareToPlay(double sampleRate);
 	void processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages);
+	// how long the output can keep sounding after the last note-off, i.e. the release time
+	double getTailLengthSeconds() const;
+	// loads a (multi-frame) wave table in the background, the synth switches to it once it is ready
+	void loadWavetable(const juce::File& file, int frameSize = WavetableLoader::DEFAULT_FRAME_SIZE);
+	// switches to one of the shapes that are compiled into the plugin, the synth starts with the sine
+	void loadBuiltInWavetable(BasicShapes::Shape shape);
+	// these can be called from any thread, the audio thread picks the change up at the start of its next block
+	void setPolyphony(int numVoices);
+	void setEnvelope(const WavetableVoiceBank::Envelope& envelope);
+	void setUnison(const WavetableVoiceBank::Unison& unison);
+	void setStereo(const WavetableVoiceBank::Stereo& stereo);
+	void setVibrato(const WavetableVoiceBank::Vibrato& vibrato);
+	void setFilter(const WavetableVoiceBank::Filter& filter);
+	// how the pressure and the timbre of MPE notes act on their voices
+	void setExpression(const WavetableVoiceBank::Expression& expression);
+	// 0 removes the routing, the mod wheel source follows CC 1 on any channel
+	void setModulation(WavetableVoiceBank::ModulationSource source,
+		WavetableVoiceBank::ModulationDestination destination, float amount);
+	void setLfo(int lfoIndex, const WavetableVoiceBank::Lfo& lfo);
+	/* Turns MPE on with the zones of layout, or off with a layout without zones. An MPE controller can also set
+	 * the zones itself with MPE configuration messages. Playing notes keep sounding, the per-note expression is
+	 * reset.
+	 */
+	void setMpeZoneLayout(const juce::MPEZoneLayout& layout);
+	// part of a preset: cubic interpolation costs more, but droops and aliases less than linear
+	void setInterpolation(Interpolation::Type type);
+	// the pitch bend of a fully deflected wheel, to either side
+	void setPitchBendRange(float semitones);
+	// notes that are already playing keep their pitch, the next note-on uses the new tuning
+	void setTuning(const Tuning& tuning);
+	// reads a Scala scale and optional keyboard mapping on the calling thread, returns false if they cannot be parsed
+	bool loadTuning(const juce::File& scaleFile, const juce::File& keyboardMappingFile = juce::File{});
+	/* Spreads the voices over numWorkers real-time threads plus the audio thread once enough of them are playing,
+	 * 0 renders on the audio thread only. The threads are started or stopped in the next prepareToPlay().
+	 */
+	void setNumRenderWorkers(int numWorkers);
 
 private:
+	// the controller that carries the timbre (the slide or y axis) of an MPE note
+	static constexpr int MPE_TIMBRE_CONTROLLER = 74;
+	static constexpr int MOD_WHEEL_CONTROLLER = 1;
+
 	void initializeOscillators();
-	std::vector<float> generateSineWaveTable();
 	void handleMidiEvent(const juce::MidiMessage&);
 	float midiNoteNumberToFrequency(int midiNoteNumber);
 	void render(juce::AudioBuffer<float>& buffer, int startSample, int endSample);
 
 	double sampleRate;
-	std::vector<WavetableOscillator> oscillators;
+	WavetableVoiceBank voices;
+	juce::SharedResourcePointer<WavetableRegistry> wavetableRegistry;
+	WavetableLoader tableLoader{ wavetableRegistry.get() };
+
+	std::atomic<int> numRenderWorkers{ 0 };
+	std::unique_ptr<RenderWorkerPool> renderWorkerPool;
+
+	std::atomic<int> polyphony{ WavetableVoiceBank::DEFAULT_POLYPHONY };
+	// the fields are published one by one, a block that sees only some of them picks up the rest one block later
+	std::atomic<float> attackSeconds{ WavetableVoiceBank::Envelope{}.attackSeconds };
+	std::atomic<float> decaySeconds{ WavetableVoiceBank::Envelope{}.decaySeconds };
+	std::atomic<float> sustainLevel{ WavetableVoiceBank::Envelope{}.sustainLevel };
+	std::atomic<float> releaseSeconds{ WavetableVoiceBank::Envelope{}.releaseSeconds };
+	std::atomic<bool> envelopeChanged{ false };
+
+	std::atomic<int> numUnisonVoices{ WavetableVoiceBank::Unison{}.numVoices };
+	std::atomic<float> unisonDetuneCents{ WavetableVoiceBank::Unison{}.detuneCents };
+	std::atomic<float> unisonStereoSpread{ WavetableVoiceBank::Unison{}.stereoSpread };
+	std::atomic<bool> unisonChanged{ false };
+
+	std::atomic<float> stereoPan{ WavetableVoiceBank::Stereo{}.pan };
+	std::atomic<float> stereoSpread{ WavetableVoiceBank::Stereo{}.spread };
+	std::atomic<bool> stereoChanged{ false };
+
+	std::atomic<float> vibratoRateHz{ WavetableVoiceBank::Vibrato{}.rateHz };
+	std::atomic<float> vibratoDepthCents{ WavetableVoiceBank::Vibrato{}.depthCents };
+	std::atomic<bool> vibratoChanged{ false };
+
+	std::atomic<WavetableVoiceBank::Filter::Mode> filterMode{ WavetableVoiceBank::Filter{}.mode };
+	std::atomic<float> filterCutoffHz{ WavetableVoiceBank::Filter{}.cutoffHz };
+	std::atomic<float> filterResonance{ WavetableVoiceBank::Filter{}.resonance };
+	std::atomic<float> filterKeyTracking{ WavetableVoiceBank::Filter{}.keyTracking };
+	std::atomic<float> filterEnvelopeOctaves{ WavetableVoiceBank::Filter{}.envelopeOctaves };
+	std::atomic<bool> filterChanged{ false };
+
+	std::atomic<float> pressureDepth{ WavetableVoiceBank::Expression{}.pressureDepth };
+	std::atomic<float> timbreOctaves{ WavetableVoiceBank::Expression{}.timbreOctaves };
+	std::atomic<bool> expressionChanged{ false };
+
+	// one atomic per cell of the matrix, and the same per LFO, so a change never needs a lock
+	std::array<std::atomic<float>, WavetableVoiceBank::NUM_MODULATION_SOURCES
+		* WavetableVoiceBank::NUM_MODULATION_DESTINATIONS> modulationAmounts{};
+	std::atomic<bool> modulationChanged{ false };
+	std::array<std::atomic<WavetableVoiceBank::Lfo::Shape>, WavetableVoiceBank::NUM_LFOS> lfoShapes{};
+	std::array<std::atomic<float>, WavetableVoiceBank::NUM_LFOS> lfoRatesHz{ WavetableVoiceBank::Lfo{}.rateHz,
+		WavetableVoiceBank::Lfo{}.rateHz };
+	std::atomic<bool> lfosChanged{ false };
+
+	std::atomic<float> pitchBendRangeSemitones{ 2.f };
+	std::atomic<Interpolation::Type> interpolation{ Interpolation::Type::linear };
+
+	// only the audio thread reads tuning, setTuning() hands a new one over through pendingTuning
+	Tuning tuning;
+	juce::SpinLock pendingTuningLock;
+	Tuning pendingTuning;
+	std::atomic<bool> tuningChanged{ false };
+
+	// only the audio thread reads zoneLayout, setMpeZoneLayout() hands a new one over like a tuning
+	juce::MPEZoneLayout zoneLayout;
+	juce::SpinLock pendingZoneLayoutLock;
+	juce::MPEZoneLayout pendingZoneLayout;
+	std::atomic<bool> zoneLayoutChanged{ false };
 };
\ No newline at end of file
@@ -0,0 +1,1267 @@
+#include "WavetableVoiceBank.h"
+
+WavetableVoiceBank::WavetableVoiceBank()
+{
+	/* In phase, the copies of a unison stack would sound like a single louder voice until the detune has pulled them
+	 * apart, and evenly spread phases would cancel each other instead. Fixed random phases behave like free running
+	 * oscillators, but render the same every time. The first copy starts at 0 like a voice without unison.
+	 */
+	juce::Random startPhaseGenerator{ 0x2545f4914f6cdd1dLL };
+
+	for (auto unisonVoice = 1; unisonVoice < MAX_UNISON_VOICES; ++unisonVoice)
+	{
+		unisonStartPhases[unisonVoice] = static_cast<juce::uint32>(startPhaseGenerator.nextInt());
+	}
+
+	setUnison({});
+	resetChannelExpressions();
+	stopAllVoices();
+	updateEnvelopeCoefficients();
+	updateFilterCoefficients();
+}
+
+Wavetable::Ptr WavetableVoiceBank::exchangeWaveTable(Wavetable::Ptr waveTable)
+{
+	/* The phases are fractions of the period, so every voice continues at the same phase and frequency in a table
+	 * of any size. Only the mip levels are picked again, which only touches the arrays, so this is safe to call on
+	 * the audio thread.
+	 */
+	tableSize = waveTable->getSize();
+	std::swap(this->waveTable, waveTable);
+
+	laneTables.fill(this->waveTable->getSamples());
+	laneLevels.fill(0);
+	laneFrames.fill(0);
+	for (auto lane = 0; lane < getNumPlayingLanes(); ++lane)
+	{
+		updateLaneTable(lane);
+	}
+
+	return waveTable;
+}
+
+bool WavetableVoiceBank::hasWaveTable() const
+{
+	return waveTable != nullptr;
+}
+
+void WavetableVoiceBank::setSampleRate(double sampleRate)
+{
+	if (sampleRate == this->sampleRate)
+	{
+		return;
+	}
+
+	/* A phase increment is frequency / sampleRate * 2^32, so scaling it by old / new sample rate keeps every
+	 * voice at its pitch and phase. A lane may now need a different mip level, e.g. a note that was safe at 96 kHz
+	 * would alias at 44.1 kHz with the same harmonics.
+	 */
+	const auto scale = static_cast<float>(this->sampleRate / sampleRate);
+	this->sampleRate = sampleRate;
+
+	for (auto voice = 0; voice < numPlayingVoices; ++voice)
+	{
+		notePhaseIncrements[voice] *= scale;
+		updateUnisonLanes(voice);
+	}
+
+	// the envelope coefficients are per sample, so they depend on the sample rate as well, and so does the cutoff
+	updateEnvelopeCoefficients();
+	updateFilterCoefficients();
+}
+
+void WavetableVoiceBank::setPolyphony(int numVoices)
+{
+	polyphony = juce::jlimit(1, MAX_VOICES, numVoices);
+}
+
+int WavetableVoiceBank::getPolyphony() const
+{
+	return polyphony;
+}
+
+int WavetableVoiceBank::getMaxPlayingVoices() const
+{
+	return std::min(polyphony, MAX_LANES / laneStride);
+}
+
+int WavetableVoiceBank::getFirstLane(int voice) const
+{
+	return voice * laneStride;
+}
+
+int WavetableVoiceBank::getNumPlayingLanes() const
+{
+	return numPlayingVoices * laneStride;
+}
+
+/* With unison stacks of different sizes, the lanes of a voice past its own stack are free, and so can be whole
+ * groups of them. A free lane has a phase increment of 0 (see clearLane()), a playing one never has.
+ */
+bool WavetableVoiceBank::isGroupPlaying(int firstLane) const
+{
+	for (auto lane = firstLane; lane < firstLane + LANES_PER_GROUP; ++lane)
+	{
+		if (phaseIncrements[lane] != 0)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/* Moves every playing voice to its place in a layout with stride lanes per voice, and frees the lanes that no
+ * voice uses in the new layout. A wider layout is filled from the back and a narrower one from the front, so that
+ * no lane is overwritten before it has moved.
+ */
+void WavetableVoiceBank::setLaneStride(int stride)
+{
+	const auto previousStride = laneStride;
+	laneStride = stride;
+
+	if (stride > previousStride)
+	{
+		for (auto voice = numPlayingVoices - 1; voice >= 0; --voice)
+		{
+			for (auto offset = previousStride - 1; offset >= 0; --offset)
+			{
+				moveLane(voice * previousStride + offset, voice * stride + offset);
+			}
+
+			for (auto offset = previousStride; offset < stride; ++offset)
+			{
+				clearLane(voice * stride + offset);
+			}
+		}
+	}
+	else if (stride < previousStride)
+	{
+		for (auto voice = 0; voice < numPlayingVoices; ++voice)
+		{
+			for (auto offset = 0; offset < stride; ++offset)
+			{
+				moveLane(voice * previousStride + offset, voice * stride + offset);
+			}
+		}
+
+		for (auto lane = numPlayingVoices * stride; lane < numPlayingVoices * previousStride; ++lane)
+		{
+			clearLane(lane);
+		}
+	}
+}
+
+// once the voices with the largest stacks have faded out, the others move closer together again
+void WavetableVoiceBank::shrinkLaneStride()
+{
+	auto stride = numPlayingVoices > 0 ? 1 : unison.numVoices;
+
+	for (auto voice = 0; voice < numPlayingVoices; ++voice)
+	{
+		stride = std::max(stride, voiceNumLanes[voice]);
+	}
+
+	if (stride < laneStride)
+	{
+		setLaneStride(stride);
+	}
+}
+
+void WavetableVoiceBank::setEnvelope(const Envelope& envelope)
+{
+	this->envelope = envelope;
+	updateEnvelopeCoefficients();
+}
+
+/* Changing the number of unison voices would have to move the lanes of every playing voice and restart their
+ * copies, which clicks. So the playing voices keep their stacks, and only the lanes of the notes that start
+ * afterwards follow the new number.
+ */
+void WavetableVoiceBank::setUnison(const Unison& unison)
+{
+	this->unison = unison;
+	this->unison.numVoices = juce::jlimit(1, MAX_UNISON_VOICES, unison.numVoices);
+
+	if (numPlayingVoices == 0)
+	{
+		laneStride = this->unison.numVoices;
+	}
+
+	for (auto voice = 0; voice < numPlayingVoices; ++voice)
+	{
+		updateUnisonLanes(voice);
+	}
+}
+
+/* The unison voices of a stack are spread evenly over [-1, 1]. Their position scales both the detune and the pan,
+ * so the outermost copies are the most detuned and the widest ones. The copies are scaled by
+ * 1 / sqrt(number of copies) since their phases are unrelated and add up in power rather than in amplitude.
+ * The pan of a lane is the pan of its voice plus the offset of its unison voice. The constant power law keeps
+ * the loudness of a lane the same at any position, with 0 dB on both sides in the centre. The gains are only
+ * computed here, at note-on or when a setting changes, so stereo costs render() one more multiply-add per lane.
+ */
+void WavetableVoiceBank::updateUnisonLanes(int voice)
+{
+	const auto firstLane = getFirstLane(voice);
+	const auto numLanes = voiceNumLanes[voice];
+	const auto voicePan = stereo.pan + voiceKeyPositions[voice] * stereo.spread;
+	const auto unisonGain = std::sqrt(1.f / static_cast<float>(numLanes));
+
+	for (auto unisonVoice = 0; unisonVoice < numLanes; ++unisonVoice)
+	{
+		const auto lane = firstLane + unisonVoice;
+		const auto position = numLanes > 1
+			? 2.f * static_cast<float>(unisonVoice) / static_cast<float>(numLanes - 1) - 1.f
+			: 0.f;
+		phaseIncrements[lane] = toPhaseIncrement(notePhaseIncrements[voice]
+			* std::exp2(position * unison.detuneCents / 2.f / 1200.f), MAX_NOTE_PHASE_INCREMENT);
+		updateLaneTable(lane);
+
+		const auto pan = juce::jlimit(-1.f, 1.f, voicePan + position * unison.stereoSpread);
+		const auto panAngle = (pan + 1.f) * juce::MathConstants<float>::pi / 4.f;
+		leftGains[lane] = juce::MathConstants<float>::sqrt2 * unisonGain * std::cos(panAngle);
+		rightGains[lane] = juce::MathConstants<float>::sqrt2 * unisonGain * std::sin(panAngle);
+
+		const auto midiNoteNumber = voiceKeyPositions[voice] * static_cast<float>(MAX_VOICES / 2)
+			+ static_cast<float>(MAX_VOICES / 2);
+		filterKeyOctaves[lane] = (midiNoteNumber - static_cast<float>(FILTER_REFERENCE_NOTE)) / 12.f;
+	}
+}
+
+void WavetableVoiceBank::setStereo(const Stereo& stereo)
+{
+	this->stereo = stereo;
+
+	for (auto voice = 0; voice < numPlayingVoices; ++voice)
+	{
+		updateUnisonLanes(voice);
+	}
+}
+
+/* The pitch ratio is applied on top of phaseIncrements while rendering, so a lane reads the mip level that is
+ * free of aliasing for the highest pitch that the bend, the vibrato and the bend of its note can reach.
+ */
+void WavetableVoiceBank::updateLaneTable(int lane)
+{
+	noteTableRatios[lane] = notePitchRatios[lane];
+	laneLevels[lane] = waveTable->getLevelForIndexIncrement(
+		getLaneIndexIncrement(lane) * noteTableRatios[lane] * getMaxPitchRatio());
+	laneFrames[lane] = std::min(laneFrames[lane], waveTable->getNumFrames() - 1);
+	laneTables[lane] = waveTable->getSamples(laneLevels[lane], laneFrames[lane]);
+}
+
+void WavetableVoiceBank::setLaneFrame(int lane, int frame)
+{
+	laneFrames[lane] = frame;
+	laneTables[lane] = waveTable->getSamples(laneLevels[lane], frame);
+}
+
+float WavetableVoiceBank::getMaxPitchRatio() const
+{
+	return pitchBendRatio * std::exp2(vibrato.depthCents / 1200.f);
+}
+
+float WavetableVoiceBank::getLaneIndexIncrement(int lane) const
+{
+	return static_cast<float>(phaseIncrements[lane]) * PHASE_TO_FRACTION * static_cast<float>(tableSize);
+}
+
+// the limit also keeps the conversion in range, a float of 2^32 or more has no uint32
+juce::uint32 WavetableVoiceBank::toPhaseIncrement(float phaseIncrement, float maxPhaseIncrement)
+{
+	return static_cast<juce::uint32>(std::min(phaseIncrement, maxPhaseIncrement));
+}
+
+void WavetableVoiceBank::setPitchBendRatio(float ratio)
+{
+	if (ratio == pitchBendRatio)
+	{
+		return;
+	}
+
+	pitchBendRatio = ratio;
+
+	for (auto lane = 0; lane < getNumPlayingLanes(); ++lane)
+	{
+		updateLaneTable(lane);
+	}
+}
+
+void WavetableVoiceBank::setVibrato(const Vibrato& vibrato)
+{
+	this->vibrato = vibrato;
+	this->vibrato.depthCents = std::max(0.f, vibrato.depthCents);
+
+	for (auto lane = 0; lane < getNumPlayingLanes(); ++lane)
+	{
+		updateLaneTable(lane);
+	}
+}
+
+void WavetableVoiceBank::setInterpolation(Interpolation::Type type)
+{
+	interpolation = type;
+}
+
+void WavetableVoiceBank::setFilter(const Filter& filter)
+{
+	// the states of a filter that was off are left over from the last time it was on and would click
+	if (this->filter.mode == Filter::Mode::off && filter.mode != Filter::Mode::off)
+	{
+		filterBandStates.fill(0.f);
+		filterLowStates.fill(0.f);
+	}
+
+	this->filter = filter;
+	this->filter.cutoffHz = std::max(0.f, filter.cutoffHz);
+	this->filter.resonance = juce::jlimit(0.f, MAX_FILTER_RESONANCE, filter.resonance);
+	updateFilterCoefficients();
+}
+
+void WavetableVoiceBank::setExpression(const Expression& expression)
+{
+	this->expression = expression;
+	this->expression.pressureDepth = juce::jlimit(0.f, 1.f, expression.pressureDepth);
+}
+
+float WavetableVoiceBank::getPressureGain(float pressure) const
+{
+	return 1.f - expression.pressureDepth + expression.pressureDepth * pressure;
+}
+
+void WavetableVoiceBank::setChannelPitchBend(int midiChannel, float semitones)
+{
+	jassert(midiChannel >= 1 && midiChannel <= NUM_MIDI_CHANNELS);
+	channelPitchBends[midiChannel - 1] = semitones;
+	channelPitchBendsChanged = true;
+}
+
+void WavetableVoiceBank::setZonePitchBend(int firstMemberChannel, int lastMemberChannel, float semitones)
+{
+	jassert(firstMemberChannel >= 1 && lastMemberChannel <= NUM_MIDI_CHANNELS);
+
+	for (auto channel = firstMemberChannel; channel <= lastMemberChannel; ++channel)
+	{
+		zonePitchBends[channel - 1] = semitones;
+	}
+
+	channelPitchBendsChanged = true;
+}
+
+void WavetableVoiceBank::setChannelPressure(int midiChannel, float pressure)
+{
+	jassert(midiChannel >= 1 && midiChannel <= NUM_MIDI_CHANNELS);
+	channelPressures[midiChannel - 1] = juce::jlimit(0.f, 1.f, pressure);
+}
+
+void WavetableVoiceBank::setChannelTimbre(int midiChannel, float timbre)
+{
+	jassert(midiChannel >= 1 && midiChannel <= NUM_MIDI_CHANNELS);
+	channelTimbres[midiChannel - 1] = juce::jlimit(0.f, 1.f, timbre);
+}
+
+void WavetableVoiceBank::resetChannelExpressions()
+{
+	channelPitchBends.fill(0.f);
+	zonePitchBends.fill(0.f);
+	channelPitchRatios.fill(1.f);
+	channelPressures.fill(0.f);
+	channelTimbres.fill(DEFAULT_TIMBRE);
+	channelPitchBendsChanged = false;
+}
+
+void WavetableVoiceBank::setModulation(ModulationSource source, ModulationDestination destination, float amount)
+{
+	modulationMatrix.setAmount(source, destination, amount);
+}
+
+void WavetableVoiceBank::setLfo(int lfoIndex, const Lfo& lfo)
+{
+	modulationMatrix.setLfo(lfoIndex, lfo);
+}
+
+void WavetableVoiceBank::setModWheel(float value)
+{
+	modulationMatrix.setModWheel(value);
+}
+
+/* The expression and the modulation of the lanes of the group for the next control block. A held lane moves to
+ * the expression of its channel and a released one keeps its expression, but both follow the modulation. The SIMD
+ * loop ramps the pitch and the gain from their current values to the targets over the control block, so a jump of
+ * a controller or an LFO is spread over CONTROL_BLOCK_SIZE samples. The mip level is picked for the higher of both
+ * pitches and the table position selects a frame of the table, both only if they change. The matrix has summed
+ * the LFOs and the mod wheel for the control block already, per lane it only adds the envelope and the velocity.
+ * Every job only touches its own lanes here, so the jobs can run in parallel.
+ */
+void WavetableVoiceBank::updateNoteExpressions(int firstLane, int controlBlock, float* pitchRatioTargets,
+	float* gainTargets, float* cutoffOctaves)
+{
+	const auto lastFrame = waveTable->getNumFrames() - 1;
+
+	for (auto groupLane = 0; groupLane < LANES_PER_GROUP; ++groupLane)
+	{
+		const auto lane = firstLane + groupLane;
+
+		if (envelopeStages[lane] != EnvelopeStage::release)
+		{
+			const auto channel = laneChannels[lane];
+			expressionPitchRatios[lane] = channelPitchRatios[channel];
+			expressionGains[lane] = getPressureGain(channelPressures[channel]);
+			noteTimbres[lane] = channelTimbres[channel];
+		}
+
+		const auto modulation = modulationMatrix.getModulation(controlBlock, envelopeLevels[lane], noteVelocities[lane]);
+
+		const auto pitchModulation = modulation[static_cast<size_t>(ModulationDestination::pitch)];
+		const auto levelModulation = modulation[static_cast<size_t>(ModulationDestination::level)];
+		const auto tablePosition = modulation[static_cast<size_t>(ModulationDestination::tablePosition)];
+
+		pitchRatioTargets[groupLane] = expressionPitchRatios[lane];
+		gainTargets[groupLane] = expressionGains[lane];
+		cutoffOctaves[groupLane] = modulation[static_cast<size_t>(ModulationDestination::filterCutoff)];
+
+		if (pitchModulation != 0.f)
+		{
+			pitchRatioTargets[groupLane] *= std::exp2(pitchModulation / 12.f);
+		}
+
+		if (levelModulation != 0.f)
+		{
+			gainTargets[groupLane] *= std::max(0.f, 1.f + levelModulation);
+		}
+
+		const auto tableRatio = std::max(pitchRatioTargets[groupLane], notePitchRatios[lane]);
+
+		if (tableRatio != noteTableRatios[lane])
+		{
+			noteTableRatios[lane] = tableRatio;
+			laneLevels[lane] = waveTable->getLevelForIndexIncrement(getLaneIndexIncrement(lane) * tableRatio
+				* getMaxPitchRatio());
+			laneTables[lane] = waveTable->getSamples(laneLevels[lane], laneFrames[lane]);
+		}
+
+		const auto frame = juce::jlimit(0, lastFrame, juce::roundToInt(tablePosition * static_cast<float>(lastFrame)));
+
+		if (frame != laneFrames[lane])
+		{
+			setLaneFrame(lane, frame);
+		}
+	}
+}
+
+/* The filter is the topology-preserving transform (TPT) of the analog state-variable filter, as described by
+ * Vadim Zavalishin and Andrew Simper. Unlike a biquad it stays well behaved while its cutoff is modulated, because
+ * its states are the outputs of the two integrators and do not depend on the coefficients. Every mode is a mix of
+ * the input and of the band and low pass outputs.
+ */
+void WavetableVoiceBank::updateFilterCoefficients()
+{
+	filterFrequency = std::min(juce::MathConstants<float>::pi * filter.cutoffHz / static_cast<float>(sampleRate),
+		MAX_FILTER_FREQUENCY);
+	filterDamping = 2.f * (1.f - filter.resonance);
+
+	switch (filter.mode)
+	{
+	case Filter::Mode::off:
+	case Filter::Mode::lowPass:
+		filterInputGain = 0.f;
+		filterBandGain = 0.f;
+		filterLowGain = 1.f;
+		break;
+	case Filter::Mode::bandPass:
+		filterInputGain = 0.f;
+		filterBandGain = 1.f;
+		filterLowGain = 0.f;
+		break;
+	case Filter::Mode::highPass:
+		filterInputGain = 1.f;
+		filterBandGain = -filterDamping;
+		filterLowGain = -1.f;
+		break;
+	case Filter::Mode::notch:
+		filterInputGain = 1.f;
+		filterBandGain = -filterDamping;
+		filterLowGain = 0.f;
+		break;
+	}
+}
+
+/* The cutoff of every lane of the group for the next control block, from the key of its voice, its envelope
+ * level, its timbre and its modulation. Between two control blocks the cutoff stays put, so the exp2() and the
+ * prewarping tan() are paid once per CONTROL_BLOCK_SIZE samples and lane. The tan() is JUCE's Pade approximation,
+ * which is accurate to about 1e-7 below MAX_FILTER_FREQUENCY.
+ */
+void WavetableVoiceBank::calculateFilterCoefficients(int firstLane, const float* cutoffOctaves, float* a1, float* a2,
+	float* a3) const
+{
+	for (auto groupLane = 0; groupLane < LANES_PER_GROUP; ++groupLane)
+	{
+		const auto lane = firstLane + groupLane;
+		const auto octaves = filter.keyTracking * filterKeyOctaves[lane] + filter.envelopeOctaves * envelopeLevels[lane]
+			+ expression.timbreOctaves * (2.f * noteTimbres[lane] - 1.f) + cutoffOctaves[groupLane];
+		const auto frequency = octaves != 0.f ? std::min(filterFrequency * std::exp2(octaves), MAX_FILTER_FREQUENCY)
+			: filterFrequency;
+		const auto g = juce::dsp::FastMathApproximations::tan(frequency);
+
+		a1[groupLane] = 1.f / (1.f + g * (g + filterDamping));
+		a2[groupLane] = g * a1[groupLane];
+		a3[groupLane] = g * a2[groupLane];
+	}
+}
+
+void WavetableVoiceBank::setRenderWorkerPool(RenderWorkerPool* pool)
+{
+	renderWorkerPool = pool;
+}
+
+/* Every stage is a one-pole filter that moves the level towards the target of the stage:
+ * level += (target - level) * coefficient. The coefficient follows from how many time constants the stage takes.
+ */
+float WavetableVoiceBank::calculateEnvelopeCoefficient(float seconds, float timeConstants) const
+{
+	const auto samplesPerTimeConstant = seconds * static_cast<float>(sampleRate) / timeConstants;
+
+	// a stage of (almost) zero length jumps to its target within one sample
+	if (samplesPerTimeConstant <= 1.f)
+	{
+		return 1.f;
+	}
+
+	return 1.f - std::exp(-1.f / samplesPerTimeConstant);
+}
+
+void WavetableVoiceBank::updateEnvelopeCoefficients()
+{
+	// the attack ends when the level reaches 1 on its way to ATTACK_TARGET
+	attackCoefficient = calculateEnvelopeCoefficient(envelope.attackSeconds,
+		std::log(ATTACK_TARGET / (ATTACK_TARGET - 1.f)));
+	// the decay and release take the level from 1 down to SILENCE_LEVEL within their time
+	decayCoefficient = calculateEnvelopeCoefficient(envelope.decaySeconds, -std::log(SILENCE_LEVEL));
+	releaseCoefficient = calculateEnvelopeCoefficient(envelope.releaseSeconds, -std::log(SILENCE_LEVEL));
+
+	for (auto lane = 0; lane < getNumPlayingLanes(); ++lane)
+	{
+		setLaneEnvelopeStage(lane, envelopeStages[lane]);
+	}
+}
+
+void WavetableVoiceBank::setEnvelopeStage(int voice, EnvelopeStage stage)
+{
+	const auto firstLane = getFirstLane(voice);
+
+	for (auto lane = firstLane; lane < firstLane + voiceNumLanes[voice]; ++lane)
+	{
+		setLaneEnvelopeStage(lane, stage);
+	}
+}
+
+void WavetableVoiceBank::setLaneEnvelopeStage(int lane, EnvelopeStage stage)
+{
+	envelopeStages[lane] = stage;
+
+	switch (stage)
+	{
+	case EnvelopeStage::attack:
+		envelopeTargets[lane] = ATTACK_TARGET;
+		envelopeCoefficients[lane] = attackCoefficient;
+		break;
+	case EnvelopeStage::decay:
+		envelopeTargets[lane] = envelope.sustainLevel;
+		envelopeCoefficients[lane] = decayCoefficient;
+		break;
+	case EnvelopeStage::release:
+		envelopeTargets[lane] = 0.f;
+		envelopeCoefficients[lane] = releaseCoefficient;
+		break;
+	}
+}
+
+void WavetableVoiceBank::startVoice(int midiNoteNumber, float frequency, int midiChannel, float velocity)
+{
+	jassert(midiChannel >= 1 && midiChannel <= NUM_MIDI_CHANNELS);
+	const auto channel = midiChannel - 1;
+	const auto note = channel * NUM_MIDI_NOTES + midiNoteNumber;
+	auto voice = voiceForNote[note];
+
+	// a note that is already held is retriggered on its own voice
+	if (voice == NO_VOICE)
+	{
+		voice = allocateVoice();
+		voiceForNote[note] = voice;
+		noteForVoice[voice] = note;
+
+		/* The new note gets the current number of unison voices, or as many as fit next to the voices that still
+		 * play with smaller stacks. A stolen voice keeps the phases and filter states of the copies that it had
+		 * before, so only the copies that it did not have start from scratch (a free voice had none).
+		 */
+		const auto numLanes = std::min(unison.numVoices, MAX_LANES / numPlayingVoices);
+
+		if (numLanes > laneStride)
+		{
+			setLaneStride(numLanes);
+		}
+
+		const auto firstLane = getFirstLane(voice);
+
+		for (auto unisonVoice = numLanes; unisonVoice < voiceNumLanes[voice]; ++unisonVoice)
+		{
+			clearLane(firstLane + unisonVoice);
+		}
+
+		for (auto unisonVoice = voiceNumLanes[voice]; unisonVoice < numLanes; ++unisonVoice)
+		{
+			phases[firstLane + unisonVoice] = unisonStartPhases[unisonVoice];
+			filterBandStates[firstLane + unisonVoice] = 0.f;
+			filterLowStates[firstLane + unisonVoice] = 0.f;
+		}
+
+		voiceNumLanes[voice] = numLanes;
+	}
+
+	voiceStartOrder[voice] = numStartedVoices++;
+	notePhaseIncrements[voice] = frequency / static_cast<float>(sampleRate) * PHASES_PER_PERIOD;
+	// the key position runs from -1 at the lowest to almost 1 at the highest midi note
+	voiceKeyPositions[voice] = static_cast<float>(midiNoteNumber - MAX_VOICES / 2) / static_cast<float>(MAX_VOICES / 2);
+
+	/* MPE controllers send the expression of a note before its note-on, so the voice starts right there instead
+	 * of ramping to it in its first control block. The bend of the channel may have changed since the last
+	 * render(), so its ratio is computed here. The modulation is added by the first control block.
+	 */
+	const auto bend = channelPitchBends[channel] + zonePitchBends[channel];
+	const auto pitchRatio = bend != 0.f ? std::exp2(bend / 12.f) : 1.f;
+	const auto firstLane = getFirstLane(voice);
+
+	for (auto lane = firstLane; lane < firstLane + voiceNumLanes[voice]; ++lane)
+	{
+		laneChannels[lane] = channel;
+		expressionPitchRatios[lane] = pitchRatio;
+		expressionGains[lane] = getPressureGain(channelPressures[channel]);
+		notePitchRatios[lane] = expressionPitchRatios[lane];
+		noteGains[lane] = expressionGains[lane];
+		noteTimbres[lane] = channelTimbres[channel];
+		noteVelocities[lane] = velocity;
+	}
+
+	updateUnisonLanes(voice);
+
+	/* The attack starts from the current level of the voice, which is 0 for a free voice. A stolen or retriggered
+	 * voice also keeps its phase and its filter state, so neither the level nor the waveform jumps and there is no
+	 * click.
+	 */
+	setEnvelopeStage(voice, EnvelopeStage::attack);
+}
+
+/* Returns a free voice or, if all allowed voices are playing, steals one: the quietest voice that is already
+ * releasing, or the oldest held voice if none is releasing.
+ */
+int WavetableVoiceBank::allocateVoice()
+{
+	if (numPlayingVoices < getMaxPlayingVoices())
+	{
+		return numPlayingVoices++;
+	}
+
+	auto quietestReleasingVoice = NO_VOICE;
+	auto oldestVoice = 0;
+
+	// all lanes of a voice share the envelope, so the first lane stands for the voice
+	for (auto voice = 0; voice < numPlayingVoices; ++voice)
+	{
+		const auto lane = getFirstLane(voice);
+
+		if (envelopeStages[lane] == EnvelopeStage::release
+			&& (quietestReleasingVoice == NO_VOICE
+				|| envelopeLevels[lane] < envelopeLevels[getFirstLane(quietestReleasingVoice)]))
+		{
+			quietestReleasingVoice = voice;
+		}
+
+		if (voiceStartOrder[voice] < voiceStartOrder[oldestVoice])
+		{
+			oldestVoice = voice;
+		}
+	}
+
+	const auto stolenVoice = quietestReleasingVoice != NO_VOICE ? quietestReleasingVoice : oldestVoice;
+
+	if (noteForVoice[stolenVoice] != NO_NOTE)
+	{
+		voiceForNote[noteForVoice[stolenVoice]] = NO_VOICE;
+		noteForVoice[stolenVoice] = NO_NOTE;
+	}
+
+	return stolenVoice;
+}
+
+void WavetableVoiceBank::stopVoice(int midiNoteNumber, int midiChannel)
+{
+	jassert(midiChannel >= 1 && midiChannel <= NUM_MIDI_CHANNELS);
+	const auto note = (midiChannel - 1) * NUM_MIDI_NOTES + midiNoteNumber;
+	const auto voice = voiceForNote[note];
+
+	if (voice == NO_VOICE)
+	{
+		return;
+	}
+
+	voiceForNote[note] = NO_VOICE;
+	noteForVoice[voice] = NO_NOTE;
+	setEnvelopeStage(voice, EnvelopeStage::release);
+}
+
+void WavetableVoiceBank::releaseAllVoices()
+{
+	for (auto voice = 0; voice < numPlayingVoices; ++voice)
+	{
+		if (noteForVoice[voice] != NO_NOTE)
+		{
+			voiceForNote[noteForVoice[voice]] = NO_VOICE;
+			noteForVoice[voice] = NO_NOTE;
+			setEnvelopeStage(voice, EnvelopeStage::release);
+		}
+	}
+}
+
+/* To keep the playing voices packed we move the last playing voice into the slot of the freed one and silence the
+ * lanes that it left behind.
+ */
+void WavetableVoiceBank::freeVoice(int voice)
+{
+	if (noteForVoice[voice] != NO_NOTE)
+	{
+		voiceForNote[noteForVoice[voice]] = NO_VOICE;
+	}
+
+	const auto lastVoice = --numPlayingVoices;
+
+	if (voice != lastVoice)
+	{
+		moveVoice(lastVoice, voice);
+	}
+
+	noteForVoice[lastVoice] = NO_NOTE;
+	voiceNumLanes[lastVoice] = 0;
+
+	const auto firstLane = getFirstLane(lastVoice);
+
+	for (auto lane = firstLane; lane < firstLane + laneStride; ++lane)
+	{
+		clearLane(lane);
+	}
+}
+
+void WavetableVoiceBank::clearLane(int lane)
+{
+	phases[lane] = 0;
+	phaseIncrements[lane] = 0;
+	envelopeLevels[lane] = 0.f;
+	envelopeTargets[lane] = 0.f;
+	envelopeStages[lane] = EnvelopeStage::release;
+	filterBandStates[lane] = 0.f;
+	filterLowStates[lane] = 0.f;
+	filterKeyOctaves[lane] = 0.f;
+	expressionPitchRatios[lane] = 1.f;
+	expressionGains[lane] = 1.f;
+	notePitchRatios[lane] = 1.f;
+	noteTableRatios[lane] = 1.f;
+	noteGains[lane] = 1.f;
+	laneFrames[lane] = 0;
+}
+
+void WavetableVoiceBank::moveVoice(int fromVoice, int toVoice)
+{
+	voiceStartOrder[toVoice] = voiceStartOrder[fromVoice];
+	voiceKeyPositions[toVoice] = voiceKeyPositions[fromVoice];
+	notePhaseIncrements[toVoice] = notePhaseIncrements[fromVoice];
+	noteForVoice[toVoice] = noteForVoice[fromVoice];
+
+	if (noteForVoice[toVoice] != NO_NOTE)
+	{
+		voiceForNote[noteForVoice[toVoice]] = toVoice;
+	}
+
+	voiceNumLanes[toVoice] = voiceNumLanes[fromVoice];
+
+	const auto fromLane = getFirstLane(fromVoice);
+	const auto toLane = getFirstLane(toVoice);
+
+	for (auto offset = 0; offset < laneStride; ++offset)
+	{
+		moveLane(fromLane + offset, toLane + offset);
+	}
+}
+
+void WavetableVoiceBank::moveLane(int fromLane, int toLane)
+{
+	phases[toLane] = phases[fromLane];
+	phaseIncrements[toLane] = phaseIncrements[fromLane];
+	envelopeLevels[toLane] = envelopeLevels[fromLane];
+	envelopeTargets[toLane] = envelopeTargets[fromLane];
+	envelopeCoefficients[toLane] = envelopeCoefficients[fromLane];
+	envelopeStages[toLane] = envelopeStages[fromLane];
+	leftGains[toLane] = leftGains[fromLane];
+	rightGains[toLane] = rightGains[fromLane];
+	laneTables[toLane] = laneTables[fromLane];
+	laneLevels[toLane] = laneLevels[fromLane];
+	laneFrames[toLane] = laneFrames[fromLane];
+	filterBandStates[toLane] = filterBandStates[fromLane];
+	filterLowStates[toLane] = filterLowStates[fromLane];
+	filterKeyOctaves[toLane] = filterKeyOctaves[fromLane];
+	expressionPitchRatios[toLane] = expressionPitchRatios[fromLane];
+	expressionGains[toLane] = expressionGains[fromLane];
+	notePitchRatios[toLane] = notePitchRatios[fromLane];
+	noteTableRatios[toLane] = noteTableRatios[fromLane];
+	noteGains[toLane] = noteGains[fromLane];
+	noteTimbres[toLane] = noteTimbres[fromLane];
+	noteVelocities[toLane] = noteVelocities[fromLane];
+	laneChannels[toLane] = laneChannels[fromLane];
+}
+
+void WavetableVoiceBank::stopAllVoices()
+{
+	numPlayingVoices = 0;
+	laneStride = unison.numVoices;
+	voiceNumLanes.fill(0);
+	voiceForNote.fill(NO_VOICE);
+	noteForVoice.fill(NO_NOTE);
+	notePhaseIncrements.fill(0.f);
+	phases.fill(0);
+	phaseIncrements.fill(0);
+	envelopeLevels.fill(0.f);
+	envelopeTargets.fill(0.f);
+	envelopeCoefficients.fill(0.f);
+	envelopeStages.fill(EnvelopeStage::release);
+	filterBandStates.fill(0.f);
+	filterLowStates.fill(0.f);
+	filterKeyOctaves.fill(0.f);
+	expressionPitchRatios.fill(1.f);
+	expressionGains.fill(1.f);
+	notePitchRatios.fill(1.f);
+	noteTableRatios.fill(1.f);
+	noteGains.fill(1.f);
+	noteTimbres.fill(DEFAULT_TIMBRE);
+	noteVelocities.fill(0.f);
+	laneFrames.fill(0);
+	laneChannels.fill(0);
+}
+
+bool WavetableVoiceBank::isNotePlaying(int midiNoteNumber, int midiChannel) const
+{
+	jassert(midiChannel >= 1 && midiChannel <= NUM_MIDI_CHANNELS);
+	return voiceForNote[(midiChannel - 1) * NUM_MIDI_NOTES + midiNoteNumber] != NO_VOICE;
+}
+
+int WavetableVoiceBank::getNumPlayingVoices() const
+{
+	return numPlayingVoices;
+}
+
+bool WavetableVoiceBank::isSilent() const
+{
+	return numPlayingVoices == 0;
+}
+
+/* The envelopes run inside the SIMD loop, but a lane can only change its stage between two control blocks. An
+ * attack thus lasts up to CONTROL_BLOCK_SIZE samples longer at a level of 1, which cannot be heard. The lanes of a
+ * voice have the same envelope, so they change their stage together even if they belong to different jobs. Every
+ * job only touches its own lanes here, so the jobs can run in parallel.
+ */
+void WavetableVoiceBank::updateEnvelopeStages(int firstLane, int endLane)
+{
+	for (auto lane = firstLane; lane < endLane; ++lane)
+	{
+		if (envelopeStages[lane] == EnvelopeStage::attack && envelopeLevels[lane] >= 1.f)
+		{
+			envelopeLevels[lane] = 1.f;
+			setLaneEnvelopeStage(lane, EnvelopeStage::decay);
+		}
+	}
+}
+
+/* Freeing a voice moves another voice into its slot, so it would move lanes between jobs and is only done after
+ * all jobs of render() have finished. A faded out voice plays for the rest of the block below SILENCE_LEVEL, which
+ * cannot be heard either.
+ * Besides released voices this frees held voices that have decayed to a silent sustain level, e.g. plucks with a
+ * sustain of 0. They would otherwise render silence until their key is released. Their note-off finds no voice
+ * and is ignored, and they do not come back if the sustain level is raised while the key is still held.
+ */
+void WavetableVoiceBank::freeSilentVoices()
+{
+	const auto previousNumPlayingVoices = numPlayingVoices;
+
+	for (auto voice = 0; voice < numPlayingVoices;)
+	{
+		const auto lane = getFirstLane(voice);
+		const auto isFading = envelopeStages[lane] == EnvelopeStage::release
+			|| (envelopeStages[lane] == EnvelopeStage::decay && envelopeTargets[lane] < SILENCE_LEVEL);
+
+		if (isFading && envelopeLevels[lane] < SILENCE_LEVEL)
+		{
+			// the last playing voice moves into this slot, so the same slot is checked again
+			freeVoice(voice);
+			continue;
+		}
+
+		++voice;
+	}
+
+	if (numPlayingVoices != previousNumPlayingVoices)
+	{
+		shrinkLaneStride();
+	}
+}
+
+/* The block is rendered in slices of at most SLICE_SIZE samples. Per slice every job renders its lanes into its
+ * own buffers and the buffers are added to the output in job order, no matter which thread rendered them.
+ */
+void WavetableVoiceBank::render(float* left, float* right, int numSamples)
+{
+	// without playing voices there is nothing to add, and the vibrato may as well pause until the next note
+	if (numPlayingVoices == 0)
+	{
+		return;
+	}
+
+	// one exp2() per channel and block, however many bend events arrived since the last one
+	if (channelPitchBendsChanged)
+	{
+		for (auto channel = 0; channel < NUM_MIDI_CHANNELS; ++channel)
+		{
+			channelPitchRatios[channel] = std::exp2((channelPitchBends[channel] + zonePitchBends[channel]) / 12.f);
+		}
+
+		channelPitchBendsChanged = false;
+	}
+
+	const auto numPlayingLanes = getNumPlayingLanes();
+	const auto numJobs = (numPlayingLanes + LANES_PER_JOB - 1) / LANES_PER_JOB;
+	const auto useWorkers = renderWorkerPool != nullptr && numPlayingLanes >= MULTITHREADING_THRESHOLD;
+
+	for (auto startSample = 0; startSample < numSamples; startSample += SLICE_SIZE)
+	{
+		numSliceSamples = std::min(SLICE_SIZE, numSamples - startSample);
+		updatePitchRatios();
+		modulationMatrix.updateSources(numSliceSamples, CONTROL_BLOCK_SIZE, sampleRate);
+
+		if (useWorkers)
+		{
+			renderWorkerPool->run(numJobs, &WavetableVoiceBank::renderJob, this);
+		}
+		else
+		{
+			for (auto jobIndex = 0; jobIndex < numJobs; ++jobIndex)
+			{
+				renderJob(jobIndex);
+			}
+		}
+
+		for (auto jobIndex = 0; jobIndex < numJobs; ++jobIndex)
+		{
+			const auto* jobLeft = jobOutputs.data() + 2 * jobIndex * SLICE_SIZE;
+			const auto* jobRight = jobLeft + SLICE_SIZE;
+
+			if (right != nullptr)
+			{
+				juce::FloatVectorOperations::add(left + startSample, jobLeft, numSliceSamples);
+				juce::FloatVectorOperations::add(right + startSample, jobRight, numSliceSamples);
+			}
+			else
+			{
+				// a centred lane has a gain of 1 on both sides, so it keeps its level in the mono mix
+				juce::FloatVectorOperations::addWithMultiply(left + startSample, jobLeft, 0.5f, numSliceSamples);
+				juce::FloatVectorOperations::addWithMultiply(left + startSample, jobRight, 0.5f, numSliceSamples);
+			}
+		}
+	}
+
+	freeSilentVoices();
+}
+
+/* The pitch bend and the vibrato change the pitch once per control block, which is fine enough for both: at
+ * 44.1 kHz that is more than 1000 steps per second. The ratios of the whole slice are computed here, before the
+ * jobs start, so every job sees the same ratios no matter on which thread it runs.
+ */
+void WavetableVoiceBank::updatePitchRatios()
+{
+	const auto phaseIncrementPerSample = juce::MathConstants<float>::twoPi * vibrato.rateHz
+		/ static_cast<float>(sampleRate);
+
+	for (auto startSample = 0; startSample < numSliceSamples; startSample += CONTROL_BLOCK_SIZE)
+	{
+		auto& pitchRatio = controlBlockPitchRatios[startSample / CONTROL_BLOCK_SIZE];
+		pitchRatio = pitchBendRatio;
+
+		if (vibrato.depthCents > 0.f)
+		{
+			pitchRatio *= std::exp2(vibrato.depthCents / 1200.f * std::sin(vibratoPhase));
+
+			const auto numControlBlockSamples = std::min(CONTROL_BLOCK_SIZE, numSliceSamples - startSample);
+			vibratoPhase += phaseIncrementPerSample * static_cast<float>(numControlBlockSamples);
+
+			if (vibratoPhase >= juce::MathConstants<float>::twoPi)
+			{
+				vibratoPhase -= juce::MathConstants<float>::twoPi;
+			}
+		}
+	}
+}
+
+void WavetableVoiceBank::renderJob(void* voiceBank, int jobIndex)
+{
+	static_cast<WavetableVoiceBank*>(voiceBank)->renderJob(jobIndex);
+}
+
+/* The interpolation policy and whether the filter is on are picked once per job, the loops below are compiled for
+ * each combination. Without the filter the loop is the same as if there was no filter at all.
+ */
+void WavetableVoiceBank::renderJob(int jobIndex)
+{
+	Interpolation::withPolicy(interpolation, [this, jobIndex](auto policy)
+	{
+		if (filter.mode != Filter::Mode::off)
+		{
+			renderJobLanes<decltype(policy), true>(jobIndex);
+		}
+		else
+		{
+			renderJobLanes<decltype(policy), false>(jobIndex);
+		}
+	});
+}
+
+/* Per control block we make one pass over the groups of the job that contain playing lanes, LANES_PER_GROUP
+ * lanes at a time. The last group may be partially filled, its unused lanes are silent.
+ */
+template <typename Policy, bool isFiltered>
+void WavetableVoiceBank::renderJobLanes(int jobIndex)
+{
+	auto* jobLeft = jobOutputs.data() + 2 * jobIndex * SLICE_SIZE;
+	auto* jobRight = jobLeft + SLICE_SIZE;
+	const auto firstLane = jobIndex * LANES_PER_JOB;
+	const auto endLane = std::min(firstLane + LANES_PER_JOB, getNumPlayingLanes());
+
+	juce::FloatVectorOperations::clear(jobLeft, numSliceSamples);
+	juce::FloatVectorOperations::clear(jobRight, numSliceSamples);
+
+	for (auto startSample = 0; startSample < numSliceSamples; startSample += CONTROL_BLOCK_SIZE)
+	{
+		const auto numControlBlockSamples = std::min(CONTROL_BLOCK_SIZE, numSliceSamples - startSample);
+
+		for (auto firstGroupLane = firstLane; firstGroupLane < endLane; firstGroupLane += LANES_PER_GROUP)
+		{
+			if (!isGroupPlaying(firstGroupLane))
+			{
+				continue;
+			}
+
+			renderGroup<Policy, isFiltered>(firstGroupLane, jobLeft + startSample, jobRight + startSample,
+				numControlBlockSamples, startSample / CONTROL_BLOCK_SIZE);
+		}
+
+		updateEnvelopeStages(firstLane, endLane);
+	}
+}
+
+/* The phase increment of every lane of the group at the start of the control block, and its step per sample, so
+ * that it ramps from the current pitch of the note to its target. Both ends are limited to Nyquist. The step is a
+ * signed difference in two's complement, so adding it to the unsigned increment also lowers it.
+ */
+void WavetableVoiceBank::calculatePhaseIncrements(int firstLane, float pitchRatio, const float* pitchRatioTargets,
+	int numSamples, juce::uint32* groupPhaseIncrements, juce::uint32* groupPhaseIncrementSteps) const
+{
+	for (auto groupLane = 0; groupLane < LANES_PER_GROUP; ++groupLane)
+	{
+		const auto lane = firstLane + groupLane;
+		const auto bentPhaseIncrement = static_cast<float>(phaseIncrements[lane]) * pitchRatio;
+		const auto start = toPhaseIncrement(bentPhaseIncrement * notePitchRatios[lane], MAX_PHASE_INCREMENT);
+		const auto end = toPhaseIncrement(bentPhaseIncrement * pitchRatioTargets[groupLane], MAX_PHASE_INCREMENT);
+		groupPhaseIncrements[groupLane] = start;
+		groupPhaseIncrementSteps[groupLane] = static_cast<juce::uint32>(
+			(static_cast<juce::int64>(end) - static_cast<juce::int64>(start)) / numSamples);
+	}
+}
+
+/* The state of the group stays in SIMD registers for the whole block. Per sample we only leave the registers to
+ * gather the neighbouring table values of every lane that the policy needs, because SIMD registers cannot index
+ * into a table. The interpolation is the same as in WavetableOscillator::render(), the filter (if any) runs on the
+ * interpolated samples before the envelope, and the lanes of the group are panned and summed into the output
+ * samples at the end. The phase increment and the gain of every note ramp linearly to their targets, which are
+ * its expression and its modulation.
+ * The phase increments are limited to half a period per sample, i.e. Nyquist, which any bend or tuning could
+ * otherwise exceed. Above Nyquist a note would only alias.
+ */
+template <typename Policy, bool isFiltered>
+void WavetableVoiceBank::renderGroup(int firstLane, float* left, float* right, int numSamples, int controlBlock)
+{
+	const auto pitchRatio = controlBlockPitchRatios[controlBlock];
+
+	// the guard samples around every table mean the interpolation never needs a modulo
+	const auto* const* tables = laneTables.data() + firstLane;
+
+	// the expression and the modulation first, the timbre and the modulation move the cutoff of the filter
+	alignas(64) float pitchRatioTargets[LANES_PER_GROUP];
+	alignas(64) float gainTargets[LANES_PER_GROUP];
+	alignas(64) float cutoffOctaves[LANES_PER_GROUP];
+	updateNoteExpressions(firstLane, controlBlock, pitchRatioTargets, gainTargets, cutoffOctaves);
+	const auto rampScale = 1.f / static_cast<float>(numSamples);
+
+	alignas(64) float filterA1[LANES_PER_GROUP]{};
+	alignas(64) float filterA2[LANES_PER_GROUP]{};
+	alignas(64) float filterA3[LANES_PER_GROUP]{};
+
+	if constexpr (isFiltered)
+	{
+		calculateFilterCoefficients(firstLane, cutoffOctaves, filterA1, filterA2, filterA3);
+	}
+
+	// the increment ramps from the current bend of every note to its target, both below Nyquist
+	alignas(64) juce::uint32 groupPhaseIncrements[LANES_PER_GROUP];
+	alignas(64) juce::uint32 groupPhaseIncrementSteps[LANES_PER_GROUP];
+	calculatePhaseIncrements(firstLane, pitchRatio, pitchRatioTargets, numSamples, groupPhaseIncrements,
+		groupPhaseIncrementSteps);
+	const auto size = static_cast<juce::uint64>(tableSize);
+
+#if JUCE_USE_SIMD
+	alignas(64) juce::uint32 groupPhases[LANES_PER_GROUP];
+	alignas(64) float nextIndexWeights[LANES_PER_GROUP];
+	alignas(64) float previousSamples[LANES_PER_GROUP];
+	alignas(64) float currentSamples[LANES_PER_GROUP];
+	alignas(64) float nextSamples[LANES_PER_GROUP];
+	alignas(64) float afterNextSamples[LANES_PER_GROUP];
+
+	auto phase = PhaseVector::fromRawArray(phases.data() + firstLane);
+	auto phaseIncrement = PhaseVector::fromRawArray(groupPhaseIncrements);
+	const auto phaseIncrementStep = PhaseVector::fromRawArray(groupPhaseIncrementSteps);
+	auto noteGain = Vector::fromRawArray(noteGains.data() + firstLane);
+	const auto noteGainStep = (Vector::fromRawArray(gainTargets) - noteGain) * rampScale;
+	auto envelopeLevel = Vector::fromRawArray(envelopeLevels.data() + firstLane);
+	const auto envelopeTarget = Vector::fromRawArray(envelopeTargets.data() + firstLane);
+	const auto envelopeCoefficient = Vector::fromRawArray(envelopeCoefficients.data() + firstLane);
+	const auto leftGain = Vector::fromRawArray(leftGains.data() + firstLane);
+	const auto rightGain = Vector::fromRawArray(rightGains.data() + firstLane);
+	const auto one = Vector::expand(1.f);
+	auto filterBandState = Vector::fromRawArray(filterBandStates.data() + firstLane);
+	auto filterLowState = Vector::fromRawArray(filterLowStates.data() + firstLane);
+	const auto a1 = Vector::fromRawArray(filterA1);
+	const auto a2 = Vector::fromRawArray(filterA2);
+	const auto a3 = Vector::fromRawArray(filterA3);
+
+	for (auto sample = 0; sample < numSamples; ++sample)
+	{
+		phase.copyToRawArray(groupPhases);
+
+		// the integer part of phase * size is the index, the fraction below it the weight of the next point
+		for (auto lane = 0; lane < LANES_PER_GROUP; ++lane)
+		{
+			const auto position = groupPhases[lane] * size;
+			const auto truncatedIndex = static_cast<int>(position >> 32);
+			nextIndexWeights[lane] = static_cast<float>(static_cast<juce::uint32>(position)) * PHASE_TO_FRACTION;
+			currentSamples[lane] = tables[lane][truncatedIndex];
+
+			if constexpr (Policy::NUM_POINTS >= 2)
+			{
+				nextSamples[lane] = tables[lane][truncatedIndex + 1];
+			}
+
+			if constexpr (Policy::NUM_POINTS >= 4)
+			{
+				previousSamples[lane] = tables[lane][truncatedIndex - 1];
+				afterNextSamples[lane] = tables[lane][truncatedIndex + 2];
+			}
+		}
+
+		// the envelopes of all lanes of the group advance by one sample, the attack overshoot is clipped at 1
+		envelopeLevel += (envelopeTarget - envelopeLevel) * envelopeCoefficient;
+		envelopeLevel = Vector::min(envelopeLevel, one);
+
+		// the points that the policy does not use are never read, so they stand in with the current samples
+		const auto nextIndexWeight = Vector::fromRawArray(nextIndexWeights);
+		const auto current = Vector::fromRawArray(currentSamples);
+		auto laneSamples = Policy::interpolate(
+			Policy::NUM_POINTS >= 4 ? Vector::fromRawArray(previousSamples) : current, current,
+			Policy::NUM_POINTS >= 2 ? Vector::fromRawArray(nextSamples) : current,
+			Policy::NUM_POINTS >= 4 ? Vector::fromRawArray(afterNextSamples) : current,
+			nextIndexWeight);
+
+		if constexpr (isFiltered)
+		{
+			// v3, v1 and v2 in the notation of Simper, followed by the update of both integrators
+			const auto v3 = laneSamples - filterLowState;
+			const auto band = filterBandState * a1 + v3 * a2;
+			const auto low = filterLowState + filterBandState * a2 + v3 * a3;
+			filterBandState = band * 2.f - filterBandState;
+			filterLowState = low * 2.f - filterLowState;
+			laneSamples = laneSamples * filterInputGain + band * filterBandGain + low * filterLowGain;
+		}
+
+		laneSamples = laneSamples * (envelopeLevel * noteGain);
+		left[sample] += (laneSamples * leftGain).sum();
+		right[sample] += (laneSamples * rightGain).sum();
+		noteGain += noteGainStep;
+
+		// advance all lanes at once, a phase that runs past the end of the period wraps around by itself
+		phase += phaseIncrement;
+		phaseIncrement += phaseIncrementStep;
+	}
+
+	phase.copyToRawArray(phases.data() + firstLane);
+	envelopeLevel.copyToRawArray(envelopeLevels.data() + firstLane);
+
+	if constexpr (isFiltered)
+	{
+		filterBandState.copyToRawArray(filterBandStates.data() + firstLane);
+		filterLowState.copyToRawArray(filterLowStates.data() + firstLane);
+	}
+#else
+	for (auto lane = firstLane; lane < firstLane + LANES_PER_GROUP; ++lane)
+	{
+		const auto* table = laneTables[lane];
+		auto& phase = phases[lane];
+		auto& envelopeLevel = envelopeLevels[lane];
+		auto phaseIncrement = groupPhaseIncrements[lane - firstLane];
+		const auto phaseIncrementStep = groupPhaseIncrementSteps[lane - firstLane];
+		auto noteGain = noteGains[lane];
+		const auto noteGainStep = (gainTargets[lane - firstLane] - noteGain) * rampScale;
+		auto& filterBandState = filterBandStates[lane];
+		auto& filterLowState = filterLowStates[lane];
+		const auto a1 = filterA1[lane - firstLane];
+		const auto a2 = filterA2[lane - firstLane];
+		const auto a3 = filterA3[lane - firstLane];
+
+		for (auto sample = 0; sample < numSamples; ++sample)
+		{
+			envelopeLevel += (envelopeTargets[lane] - envelopeLevel) * envelopeCoefficients[lane];
+			envelopeLevel = std::min(envelopeLevel, 1.f);
+
+			const auto position = phase * size;
+			const auto truncatedIndex = static_cast<int>(position >> 32);
+			const auto nextIndexWeight = static_cast<float>(static_cast<juce::uint32>(position)) * PHASE_TO_FRACTION;
+			auto laneSample = Policy::interpolate(table[truncatedIndex - 1], table[truncatedIndex],
+				table[truncatedIndex + 1], table[truncatedIndex + 2], nextIndexWeight);
+
+			if constexpr (isFiltered)
+			{
+				const auto v3 = laneSample - filterLowState;
+				const auto band = filterBandState * a1 + v3 * a2;
+				const auto low = filterLowState + filterBandState * a2 + v3 * a3;
+				filterBandState = band * 2.f - filterBandState;
+				filterLowState = low * 2.f - filterLowState;
+				laneSample = laneSample * filterInputGain + band * filterBandGain + low * filterLowGain;
+			}
+
+			laneSample *= envelopeLevel * noteGain;
+			left[sample] += laneSample * leftGains[lane];
+			right[sample] += laneSample * rightGains[lane];
+			noteGain += noteGainStep;
+
+			phase += phaseIncrement;
+			phaseIncrement += phaseIncrementStep;
+		}
+	}
+#endif
+
+	// the ramps end exactly on their targets, which are where the next control block starts
+	std::copy(pitchRatioTargets, pitchRatioTargets + LANES_PER_GROUP, notePitchRatios.data() + firstLane);
+	std::copy(gainTargets, gainTargets + LANES_PER_GROUP, noteGains.data() + firstLane);
+}
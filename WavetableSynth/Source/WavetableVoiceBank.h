@@ -0,0 +1,407 @@
+#pragma once
+#include "JuceHeader.h"
+#include "Wavetable.h"
+#include "RenderWorkerPool.h"
+#include "Interpolation.h"
+#include "ModulationMatrix.h"
+#include <array>
+
+/*
+ * This class holds the state of all voices of the synthesizer in a structure-of-arrays layout. Instead of one
+ * WavetableOscillator object per voice (each one with its own index, indexIncrement and waveTable) the phases and
+ * phase increments of all voices live side by side in contiguous, aligned arrays. In this way render() can load
+ * the state of 4 (SSE/NEON) or 8 (AVX) neighbouring lanes into one SIMD register and advance all of them with a
+ * single instruction.
+ * A phase is a 32-bit fixed-point fraction of the period, which wraps around at the end of the period by itself
+ * and loses no precision however long a note is held. The table index is the top 32 bits of phase * table size,
+ * i.e. the top log2(size) bits of the phase for the usual power-of-two tables, and the bits below it are the
+ * weight of the interpolation. Since the phase does not depend on the size of the table, exchanging the table
+ * leaves the lanes alone.
+ * A voice plays one note and consists of as many lanes as there are unison voices, i.e. detuned copies of the note
+ * with their own phase and stereo position. The lanes of a voice sit next to each other, so a unison stack is
+ * rendered by the same SIMD loop as separate notes and costs one lane per copy instead of one oscillator per copy.
+ * Every voice keeps the number of unison voices that it started with. The voices are laneStride lanes apart, the
+ * largest stack among them, and a smaller stack leaves the rest of its lanes free.
+ * Every lane has a left and a right gain, from the pan of its voice and the offset of its unison copy, and the
+ * SIMD loop accumulates both sides in the same pass.
+ * The arrays are a preallocated pool of MAX_LANES lanes, of which at most getPolyphony() voices play at once. The
+ * playing voices are kept packed at the front of the arrays: starting a note appends a voice and a voice whose
+ * release has faded out is replaced by the last playing voice. Both are O(1) per lane and render() only visits the
+ * groups that contain playing lanes, so its cost scales with the number of sounding lanes.
+ * Pitch bend and vibrato apply to all voices at once. They are one pitch ratio per control block that the SIMD
+ * loop multiplies into the index increments, so neither a note-on nor a sample ever calls pow().
+ * With MPE every note also has its own pitch bend, pressure and timbre. A voice is keyed by its midi channel and
+ * note, and the expression is stored per channel, so a controller event only stores one value. Once per control
+ * block the held lanes of a channel pick up its values, and the SIMD loop ramps their index increment and gain
+ * linearly to the new values over the block. Dense controller streams therefore cost no more than one update per
+ * control block and lane, and do not step.
+ * The lanes read their ModulationMatrix in the same pass as the expression. Pitch and level ride on the same ramps
+ * as the expression, the table position and the cutoff step per control block.
+ * Every lane has an ADSR envelope. The envelopes are advanced per sample inside the SIMD loop, the change from
+ * attack to decay is checked once per CONTROL_BLOCK_SIZE samples and faded out voices are freed after render().
+ * Every lane also has a state-variable filter, whose two states live in the same kind of arrays and are advanced
+ * by the SIMD loop for all lanes of a group at once. Its cutoff follows the key and the envelope of the voice and
+ * is recomputed once per control block, so the filter costs a few multiply-adds per lane and sample.
+ * The playing lanes are rendered in jobs of LANES_PER_JOB lanes, each into its own buffers, and the buffers are
+ * added to the output in job order. Above MULTITHREADING_THRESHOLD lanes the jobs can be spread over a
+ * RenderWorkerPool. Since the jobs and the order of the additions are the same either way, the output does not
+ * depend on the number of threads, down to the last bit.
+ */
+class WavetableVoiceBank
+{
+public:
+	static constexpr int MAX_VOICES = 128;
+	static constexpr int DEFAULT_POLYPHONY = 32;
+	static constexpr int MAX_UNISON_VOICES = 16;
+	// enough for DEFAULT_POLYPHONY voices with MAX_UNISON_VOICES unison voices each
+	static constexpr int MAX_LANES = 512;
+
+	struct Envelope
+	{
+		float attackSeconds = 0.005f;
+		float decaySeconds = 0.1f;
+		float sustainLevel = 1.f;
+		float releaseSeconds = 0.05f;
+	};
+
+	struct Unison
+	{
+		int numVoices = 1;
+		// the distance between the lowest and the highest detuned copy
+		float detuneCents = 0.f;
+		// 0 keeps all copies in the centre, 1 spreads them from hard left to hard right
+		float stereoSpread = 0.f;
+	};
+
+	struct Stereo
+	{
+		// -1 is hard left, 1 hard right
+		float pan = 0.f;
+		// spreads the voices by key, from the lowest note on the left to the highest on the right at 1
+		float spread = 0.f;
+	};
+
+	struct Vibrato
+	{
+		float rateHz = 5.f;
+		// the deviation of the pitch to either side, 0 turns the vibrato off
+		float depthCents = 0.f;
+	};
+
+	struct Filter
+	{
+		enum class Mode
+		{
+			off,
+			lowPass,
+			bandPass,
+			highPass,
+			notch
+		};
+
+		Mode mode = Mode::off;
+		float cutoffHz = 20000.f;
+		// 0 gives no peak at the cutoff, towards 1 the filter rings longer and longer
+		float resonance = 0.f;
+		// at 1 the cutoff follows the note, one octave per octave away from middle C
+		float keyTracking = 0.f;
+		// how far the envelope of the voice moves the cutoff at its peak, negative values close the filter
+		float envelopeOctaves = 0.f;
+	};
+
+	// how the per-note pressure and timbre of MPE act on a voice, the per-note pitch bend always applies
+	struct Expression
+	{
+		// 0 ignores the pressure, at 1 the level of a voice follows it from silence at 0 to full level at 1
+		float pressureDepth = 0.f;
+		// how far the filter cutoff moves as the timbre goes from its centre to either end
+		float timbreOctaves = 0.f;
+	};
+
+	using ModulationSource = ModulationMatrix::Source;
+	using ModulationDestination = ModulationMatrix::Destination;
+	using Lfo = ModulationMatrix::Lfo;
+
+	static constexpr int NUM_MODULATION_SOURCES = ModulationMatrix::NUM_SOURCES;
+	static constexpr int NUM_MODULATION_DESTINATIONS = ModulationMatrix::NUM_DESTINATIONS;
+	static constexpr int NUM_LFOS = ModulationMatrix::NUM_LFOS;
+
+	static constexpr int NUM_MIDI_CHANNELS = 16;
+	// the centre of the timbre, which is where MPE puts it until the controller sends a value
+	static constexpr float DEFAULT_TIMBRE = 0.5f;
+
+	WavetableVoiceBank();
+
+	/* Replaces the table of all voices, playing voices continue at the same position of their period. The
+	 * previous table is returned so that the caller decides on which thread it gets released.
+	 */
+	Wavetable::Ptr exchangeWaveTable(Wavetable::Ptr waveTable);
+	bool hasWaveTable() const;
+	// playing voices keep their pitch and phase, nothing is allocated
+	void setSampleRate(double sampleRate);
+
+	/* A smaller polyphony does not cut off voices that are already playing, new notes steal voices until the
+	 * number of playing voices has dropped below the new limit. With unison the polyphony is also limited to
+	 * MAX_LANES / number of unison voices.
+	 */
+	void setPolyphony(int numVoices);
+	int getPolyphony() const;
+	// playing voices continue with the new times from their current level
+	void setEnvelope(const Envelope& envelope);
+	/* The detune and spread of playing voices change right away. A different number of unison voices only applies to
+	 * the notes that start afterwards, the playing voices keep their stacks until they have faded out.
+	 */
+	void setUnison(const Unison& unison);
+	// playing voices move to their new position right away
+	void setStereo(const Stereo& stereo);
+	// the pitch of all voices is multiplied by ratio, e.g. 2 for a bend up by one octave
+	void setPitchBendRatio(float ratio);
+	void setVibrato(const Vibrato& vibrato);
+	// linear by default, the policy is picked once per render job and not per sample
+	void setInterpolation(Interpolation::Type type);
+	/* Playing voices keep their filter state and move to the new cutoff in their next control block. Switching the
+	 * filter on starts every voice from an empty filter.
+	 */
+	void setFilter(const Filter& filter);
+	void setExpression(const Expression& expression);
+	// 0 removes the routing, the cost of the matrix grows with the routings that are not 0
+	void setModulation(ModulationSource source, ModulationDestination destination, float amount);
+	// the LFOs run freely and are shared by all voices
+	void setLfo(int lfoIndex, const Lfo& lfo);
+	// from 0 to 1
+	void setModWheel(float value);
+	// pass nullptr to render on the calling thread only, the pool must outlive its use in render()
+	void setRenderWorkerPool(RenderWorkerPool* pool);
+
+	/* The same note on different channels plays on different voices. Without MPE the caller passes the same channel
+	 * for all notes. A new voice starts with the current expression of its channel.
+	 */
+	void startVoice(int midiNoteNumber, float frequency, int midiChannel = 1, float velocity = 1.f);
+	// the voice of the note enters its release stage and stops playing once it has faded out
+	void stopVoice(int midiNoteNumber, int midiChannel = 1);
+	void releaseAllVoices();
+	// silences every voice immediately
+	void stopAllVoices();
+	bool isNotePlaying(int midiNoteNumber, int midiChannel = 1) const;
+	/* The per-note expression of MPE, i.e. of all held notes of a channel. Released notes keep the values that they
+	 * had when their key was released, so a new note on the same channel does not bend their release.
+	 */
+	void setChannelPitchBend(int midiChannel, float semitones);
+	// the bend of an MPE zone's master channel, which adds to the per-note bend of every member channel of the zone
+	void setZonePitchBend(int firstMemberChannel, int lastMemberChannel, float semitones);
+	// from 0 to 1
+	void setChannelPressure(int midiChannel, float pressure);
+	// from 0 to 1
+	void setChannelTimbre(int midiChannel, float timbre);
+	// back to no bend, no pressure and a centred timbre on every channel
+	void resetChannelExpressions();
+	int getNumPlayingVoices() const;
+	// true once every voice has faded out, render() would then only add silence
+	bool isSilent() const;
+
+	// adds numSamples samples of all playing voices onto left and right, or a mono mix onto left if right is nullptr
+	void render(float* left, float* right, int numSamples);
+
+private:
+#if JUCE_USE_SIMD
+	using Vector = juce::dsp::SIMDRegister<float>;
+	using PhaseVector = juce::dsp::SIMDRegister<juce::uint32>;
+	static constexpr int LANES_PER_GROUP = static_cast<int>(Vector::SIMDNumElements);
+#else
+	static constexpr int LANES_PER_GROUP = 4;
+#endif
+	static_assert(MAX_LANES % LANES_PER_GROUP == 0, "lanes must split into whole SIMD groups");
+	static_assert(MAX_LANES >= MAX_UNISON_VOICES, "a voice must fit into the lanes");
+
+	static constexpr int CONTROL_BLOCK_SIZE = 32;
+	static constexpr int LANES_PER_JOB = 16;
+	static constexpr int MAX_JOBS = MAX_LANES / LANES_PER_JOB;
+	static_assert(LANES_PER_JOB % LANES_PER_GROUP == 0, "jobs must consist of whole SIMD groups");
+	// the jobs render at most this many samples at once, so that their buffers have a fixed size
+	static constexpr int SLICE_SIZE = 8 * CONTROL_BLOCK_SIZE;
+	// below this many lanes a job is too short to pay for handing it to another thread
+	static constexpr int MULTITHREADING_THRESHOLD = 32;
+	static constexpr int MAX_CONTROL_BLOCKS_PER_SLICE = SLICE_SIZE / CONTROL_BLOCK_SIZE;
+	static_assert(MAX_CONTROL_BLOCKS_PER_SLICE <= ModulationMatrix::MAX_CONTROL_BLOCKS,
+		"the matrix must hold the offsets of a whole slice");
+	// a releasing voice below -80 dB is inaudible and its slot is freed
+	static constexpr float SILENCE_LEVEL = 1.0e-4f;
+	// one period in units of the phase, 2^32
+	static constexpr float PHASES_PER_PERIOD = 4294967296.f;
+	static constexpr float PHASE_TO_FRACTION = 1.f / PHASES_PER_PERIOD;
+	// the largest float below 2^32, a note of (almost) the sample rate
+	static constexpr float MAX_NOTE_PHASE_INCREMENT = 4294967040.f;
+	// half a period per sample, i.e. Nyquist
+	static constexpr float MAX_PHASE_INCREMENT = 0.5f * PHASES_PER_PERIOD;
+	/* The attack approaches a level above 1 so that it reaches 1 in finite time, like the charging capacitor of
+	 * an analog envelope. The envelope is clipped at 1 until the stage changes to the decay.
+	 */
+	static constexpr float ATTACK_TARGET = 1.2f;
+	// the filter would oscillate on its own at a resonance of 1
+	static constexpr float MAX_FILTER_RESONANCE = 0.98f;
+	/* The cutoff is kept below Nyquist, where the prewarped frequency of the filter goes to infinity. As
+	 * pi * cutoff / sampleRate, this is 0.49 times the sample rate.
+	 */
+	static constexpr float MAX_FILTER_FREQUENCY = 0.49f * juce::MathConstants<float>::pi;
+	static constexpr int FILTER_REFERENCE_NOTE = 60;
+
+	enum class EnvelopeStage
+	{
+		attack,
+		decay,
+		release
+	};
+
+	int getMaxPlayingVoices() const;
+	int getFirstLane(int voice) const;
+	int getNumPlayingLanes() const;
+	void setLaneStride(int stride);
+	void shrinkLaneStride();
+	void moveLane(int fromLane, int toLane);
+	void clearLane(int lane);
+	int allocateVoice();
+	void freeVoice(int voice);
+	void moveVoice(int fromVoice, int toVoice);
+	void updateUnisonLanes(int voice);
+	void updateLaneTable(int lane);
+	float getMaxPitchRatio() const;
+	// the index increment in samples of the table, which the mip level is picked for
+	float getLaneIndexIncrement(int lane) const;
+	static juce::uint32 toPhaseIncrement(float phaseIncrement, float maxPhaseIncrement);
+	void calculatePhaseIncrements(int firstLane, float pitchRatio, const float* pitchRatioTargets, int numSamples,
+		juce::uint32* groupPhaseIncrements, juce::uint32* groupPhaseIncrementSteps) const;
+	void updatePitchRatios();
+	bool isGroupPlaying(int firstLane) const;
+	void setEnvelopeStage(int voice, EnvelopeStage stage);
+	void setLaneEnvelopeStage(int lane, EnvelopeStage stage);
+	void updateEnvelopeStages(int firstLane, int endLane);
+	void freeSilentVoices();
+	void updateEnvelopeCoefficients();
+	float calculateEnvelopeCoefficient(float seconds, float timeConstants) const;
+	void updateFilterCoefficients();
+	void calculateFilterCoefficients(int firstLane, const float* cutoffOctaves, float* a1, float* a2, float* a3) const;
+	float getPressureGain(float pressure) const;
+	void updateNoteExpressions(int firstLane, int controlBlock, float* pitchRatioTargets, float* gainTargets,
+		float* cutoffOctaves);
+	void setLaneFrame(int lane, int frame);
+	static void renderJob(void* voiceBank, int jobIndex);
+	void renderJob(int jobIndex);
+	template <typename Policy, bool isFiltered>
+	void renderJobLanes(int jobIndex);
+	template <typename Policy, bool isFiltered>
+	void renderGroup(int firstLane, float* left, float* right, int numSamples, int controlBlock);
+
+	// all voices point into the same shared table
+	Wavetable::Ptr waveTable;
+	int tableSize = 0;
+	double sampleRate = 44100.0;
+	int polyphony = DEFAULT_POLYPHONY;
+
+	Envelope envelope;
+	float attackCoefficient = 1.f;
+	float decayCoefficient = 1.f;
+	float releaseCoefficient = 1.f;
+
+	// the unison of the notes that start next, and the start phase of every copy
+	Unison unison;
+	std::array<juce::uint32, MAX_UNISON_VOICES> unisonStartPhases{};
+
+	Stereo stereo;
+
+	Interpolation::Type interpolation = Interpolation::Type::linear;
+
+	/* The filter output mixes the input with the band and low pass outputs, which makes every mode one set of
+	 * three gains, e.g. the high pass is input - damping * band - low.
+	 */
+	Filter filter;
+	Expression expression;
+	// pi * cutoffHz / sampleRate, before the key tracking and the envelope
+	float filterFrequency = 1.f;
+	// 1 / Q
+	float filterDamping = 2.f;
+	float filterInputGain = 1.f;
+	float filterBandGain = 0.f;
+	float filterLowGain = 0.f;
+	float pitchBendRatio = 1.f;
+	Vibrato vibrato;
+	// the phase of the vibrato in radians, advanced once per control block
+	float vibratoPhase = 0.f;
+	// the pitch ratio of every control block of the slice that the jobs are rendering
+	std::array<float, MAX_CONTROL_BLOCKS_PER_SLICE> controlBlockPitchRatios{};
+
+	ModulationMatrix modulationMatrix;
+
+	static constexpr int NO_VOICE = -1;
+	static constexpr int NO_NOTE = -1;
+	static constexpr int NUM_MIDI_NOTES = 128;
+
+	/* Voices [0, numPlayingVoices) are playing, the voice of a held note is found through voiceForNote in O(1). A
+	 * note is keyed by channel and note number, (midiChannel - 1) * NUM_MIDI_NOTES + midiNoteNumber.
+	 * A releasing voice no longer belongs to a note, so the same note can be played again while it fades out.
+	 */
+	int numPlayingVoices = 0;
+	std::array<int, NUM_MIDI_CHANNELS * NUM_MIDI_NOTES> voiceForNote{};
+	std::array<int, MAX_VOICES> noteForVoice{};
+	// the order in which the voices were started, the oldest voice has the smallest value
+	juce::uint64 numStartedVoices = 0;
+	std::array<juce::uint64, MAX_VOICES> voiceStartOrder{};
+	// the phase increment of the note itself, before the unison detune, as a float so that it can be scaled
+	std::array<float, MAX_VOICES> notePhaseIncrements{};
+	// where the note of the voice sits on the keyboard, in [-1, 1), for the key spread of the pan
+	std::array<float, MAX_VOICES> voiceKeyPositions{};
+	// the number of unison voices of every voice, at most laneStride
+	std::array<int, MAX_VOICES> voiceNumLanes{};
+	int laneStride = 1;
+
+	// the per-note expression of every midi channel, as the controller sent it last
+	std::array<float, NUM_MIDI_CHANNELS> channelPitchBends{};
+	// the master bend of the zone that the channel is a member of
+	std::array<float, NUM_MIDI_CHANNELS> zonePitchBends{};
+	// exp2(total bend / 12) of every channel, recomputed at the start of render() if a bend changed in between
+	std::array<float, NUM_MIDI_CHANNELS> channelPitchRatios{};
+	bool channelPitchBendsChanged = false;
+	std::array<float, NUM_MIDI_CHANNELS> channelPressures{};
+	std::array<float, NUM_MIDI_CHANNELS> channelTimbres{};
+
+	/* The lanes of voice v are [v * laneStride, v * laneStride + voiceNumLanes[v]). A free lane has a phase
+	 * increment of 0 and an envelope level and target of 0, so that it can stay inside a SIMD group together with
+	 * playing lanes without being heard.
+	 */
+	alignas(64) std::array<juce::uint32, MAX_LANES> phases{};
+	// the phase increment of every unison copy, before the bends and the modulation
+	alignas(64) std::array<juce::uint32, MAX_LANES> phaseIncrements{};
+	alignas(64) std::array<float, MAX_LANES> envelopeLevels{};
+	alignas(64) std::array<float, MAX_LANES> envelopeTargets{};
+	alignas(64) std::array<float, MAX_LANES> envelopeCoefficients{};
+	alignas(64) std::array<float, MAX_LANES> leftGains{};
+	alignas(64) std::array<float, MAX_LANES> rightGains{};
+	// the two integrator states of the filter of every lane, the band and the low pass output of the last sample
+	alignas(64) std::array<float, MAX_LANES> filterBandStates{};
+	alignas(64) std::array<float, MAX_LANES> filterLowStates{};
+	// the octaves between the note of the lane and FILTER_REFERENCE_NOTE, for the key tracking
+	alignas(64) std::array<float, MAX_LANES> filterKeyOctaves{};
+	/* The per-note expression of every lane: the pitch ratio of its bend, the gain of its pressure and its timbre,
+	 * and the index of the midi channel that it follows while it is held.
+	 */
+	alignas(64) std::array<float, MAX_LANES> expressionPitchRatios{};
+	alignas(64) std::array<float, MAX_LANES> expressionGains{};
+	alignas(64) std::array<float, MAX_LANES> noteTimbres{};
+	// the pitch ratio and gain of every lane at the start of the next control block, expression and modulation
+	alignas(64) std::array<float, MAX_LANES> notePitchRatios{};
+	alignas(64) std::array<float, MAX_LANES> noteGains{};
+	alignas(64) std::array<float, MAX_LANES> noteVelocities{};
+	// the note pitch ratio that the mip level of the lane was picked for
+	std::array<float, MAX_LANES> noteTableRatios{};
+	std::array<int, MAX_LANES> laneChannels{};
+	std::array<EnvelopeStage, MAX_LANES> envelopeStages{};
+	// every lane reads the band-limited mip level of waveTable that suits its frequency, of its frame of the table
+	std::array<const float*, MAX_LANES> laneTables{};
+	std::array<int, MAX_LANES> laneLevels{};
+	std::array<int, MAX_LANES> laneFrames{};
+
+	RenderWorkerPool* renderWorkerPool = nullptr;
+	// the number of samples of the slice that the jobs are rendering
+	int numSliceSamples = 0;
+	// every job has a left and a right buffer
+	alignas(64) std::array<float, 2 * MAX_JOBS * SLICE_SIZE> jobOutputs{};
+};